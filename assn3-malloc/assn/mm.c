@@ -1,28 +1,46 @@
 /*
- * This implementation uses segregated best fit lists. Our segregated
- * lists are arranged in the following order:
- * 	1. For small sizes for up to 128B, there is a distinct
- *	   segregated list for each valid size.
- *	2. For higher sizes, the segregated lists are arranged in ranges
- *	   based on the powers of 2. For example, the lists are arranged 
- * 
- * Each segregated list is arranged in LIFO order with one optimization.
- * The optimizing feature is that the free block with the biggest size
- * in each segregated list is placed in the beginning of the list. This
- * gives a significant improvement in throughput since we don't need to
- * traverse through the entire segregated list.
+ * This implementation uses segregated best fit lists. The size classes
+ * come from mm_size_classes.h, which is generated by mmclass from the
+ * block sizes of a workload (see mmclass.c, "make size-classes"):
+ * size_class_max[i] is the largest block size kept in list i and the
+ * last list takes everything bigger. The default table has a list for
+ * each block size up to 128B, then ranges based on the powers of 2.
+ *
+ * The segregated lists are kept out of band: each list is a pair of
+ * dense arrays outside the heap, one holding the free block pointers and
+ * one their sizes. The fit search only scans the size array, so the only
+ * heap memory it touches is the block it picks. The index of each free
+ * block in its list is kept in a slot map, a hash table on the block
+ * address, so moving a block within its list never writes to the block
+ * itself. The slot map and the list arrays take memory in proportion to
+ * the number of free blocks, outside memlib's heap, so mdriver does not
+ * count it; mm_get_stats reports it.
  * 
  */
 
+#define _GNU_SOURCE             /* for mremap */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdint.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "mm.h"
 #include "memlib.h"
+#include "mmprof.h"
+#include "mm_size_classes.h"
+
+/* mm_get_stats reports one entry per segregated list */
+#if FREE_SIZE_BUCKETS > MM_STATS_MAX_BINS
+#error "mm_size_classes.h has more lists than mm_stats_t has bins (MM_STATS_MAX_BINS)"
+#endif
 
 /*********************************************************
  * NOTE TO STUDENTS: Before you do anything else, please
@@ -47,9 +65,17 @@ team_t team = {
 void add_to_free_list(void *bp);
 void remove_free_block(void *bp);
 void print_fl();
+void print_seg(int type);
 void *get_segregated_list_ptr(size_t size);
+void free_slot_grow(void);
 int get_segregated_index(size_t size);
+void build_class_lookup(void);
 void * find_segregated_best_fit(size_t asize);
+void * find_page_fit(size_t asize);
+void *heap_malloc(size_t size);
+size_t page_pad(void *bp);
+void region_free(void *bp);
+void lifetime_record_free(void *bp);
 
 /*************************************************************************
  * Basic Constants and Macros
@@ -60,6 +86,46 @@ void * find_segregated_best_fit(size_t asize);
 #define CHUNKSIZE   (1<<7)      /* initial heap size (bytes) */
 
 #define MAX(x,y) ((x) > (y)?(x) :(y))
+#define MIN(x,y) ((x) < (y)?(x) :(y))
+
+/* Requests bigger than this would wrap around when rounded up to a block size */
+#define MAX_REQUEST (SIZE_MAX - 2 * DSIZE)
+
+/* Blocks this big start on a page so mm_realloc can move them with mremap */
+#define REMAP_MIN       (1024 * 1024)
+
+/* Block sizes counted one by one when built with -DMM_SIZE_HISTOGRAM */
+#define HIST_MAX_SIZE   (1 << 20)
+
+/* Lifetime regions are carved out of chunks of this size, objects up to 1/8 of it */
+#define REGION_CHUNK    (16 * 1024)
+#define REGION_MAX      (REGION_CHUNK / 8)
+
+/* A region chunk starts with its live object count, its hint and how far it was bump allocated */
+#define CHUNK_HDR       (2 * DSIZE)
+#define CHUNK_LIVE(c)   (*(size_t *)(c))
+#define CHUNK_HINT(c)   (*(size_t *)((char *)(c) + WSIZE))
+#define CHUNK_TOP(c)    (*(char **)((char *)(c) + 2 * WSIZE))
+
+/* Freed region objects wait on a free list per object size, linked through their payload */
+#define REGION_CLASSES  (REGION_MAX / DSIZE + 2)
+#define REGION_NEXT(bp) (*(char **)(bp))
+#define REGION_PREV(bp) (*(char **)((char *)(bp) + WSIZE))
+
+/* Each region object keeps a pointer to its chunk in front of its header */
+#define OBJ_CHUNK(bp)   (*(char **)((char *)(bp) - DSIZE))
+
+/* MM_HINT_AUTO observes one allocation in LIFETIME_RATE, up to LIFETIME_SLOTS at a time */
+#define LIFETIME_RATE   64
+#define LIFETIME_SLOTS  256
+#define LIFETIME_MIN_SAMPLES 8
+
+/* Average lifetimes, in bytes allocated meanwhile, below/above which a size is short/long lived */
+#define SHORT_LIFETIME  (256 * 1024)
+#define LONG_LIFETIME   (16 * 1024 * 1024)
+
+/* mm_calloc zeroes blocks at least this big with non-temporal stores */
+#define STREAM_ZERO_MIN (256 * 1024)
 
 /* Pack a size and allocated bit into a word */
 #define PACK(size, alloc) ((size) | (alloc))
@@ -72,6 +138,32 @@ void * find_segregated_best_fit(size_t asize);
 #define GET_SIZE(p)     (GET(p) & ~(DSIZE - 1))
 #define GET_ALLOC(p)    (GET(p) & 0x1)
 
+/* Read the sampled bit the heap profiler keeps in the header */
+#define SAMPLED_BIT     0x2
+#define GET_SAMPLED(p)  (GET(p) & SAMPLED_BIT)
+
+/* Marks a free block that place() split off and nothing has touched since */
+#define SPLIT_BIT       0x4
+#define GET_SPLIT(p)    (GET(p) & SPLIT_BIT)
+
+/*
+ * Marks an object served from a lifetime region (see mm_malloc_hint).
+ * Block sizes only leave the low log2(DSIZE) bits free, so regions
+ * are only used with 64 bit words.
+ */
+#define REGION_BIT      0x8
+#define GET_REGION(p)   (REGION_BIT < DSIZE && (GET(p) & REGION_BIT))
+
+/* Marks an allocated block whose lifetime is being observed; free blocks use the bit for SPLIT_BIT */
+#define LIFETIME_BIT    SPLIT_BIT
+#define GET_LIFETIME(p) (GET_ALLOC(p) && (GET(p) & LIFETIME_BIT))
+
+/* Count size bytes towards the next profiler sample, tagging bp if it is picked */
+#define PROF_ALLOC(bp, size) do { \
+	if ((mm_prof_bytes_until_sample -= (long)(size)) < 0 && mm_prof_record_alloc((bp), (size))) \
+		PUT(HDRP(bp), GET(HDRP(bp)) | SAMPLED_BIT); \
+} while (0)
+
 /* Given block ptr bp, compute address of its header and footer */
 #define HDRP(bp)        ((char *)(bp) - WSIZE)
 #define FTRP(bp)        ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
@@ -80,20 +172,117 @@ void * find_segregated_best_fit(size_t asize);
 #define NEXT_BLKP(bp) ((char *)(bp) + GET_SIZE(((char *)(bp) - WSIZE)))
 #define PREV_BLKP(bp) ((char *)(bp) - GET_SIZE(((char *)(bp) - DSIZE)))
 
-/* Get the pointer of the address of the previous and next free block */
-#define LOCATION_PREV_FREE_BLKP(bp)	((char *)(bp))
-#define LOCATION_NEXT_FREE_BLKP(bp) ((char *)(bp) + WSIZE)
+/* Free list sizes are kept in DSIZE units, clamped to 32 bits so the fit search compares 4 at a time */
+#define SIZE_UNITS(size)	((uint32_t)MIN((size) / DSIZE, (size_t)UINT32_MAX))
+
+/* Get free block bp's index in its segregated list, UINT32_MAX if it is in none */
+#define GET_FREE_SLOT(bp)	(free_slot_map[free_slot_find(bp)].key != 0 ? free_slot_map[free_slot_find(bp)].slot : UINT32_MAX)
+
+/* get_segregated_index looks sizes up to this in a table, bigger ones walk size_class_max */
+#define CLASS_LOOKUP_MAX	(32 * 1024)
 
-/* Get the address of the next and previous free blocks */
-#define GET_NEXT_FREE_BLK(bp) GET((uintptr_t)(LOCATION_NEXT_FREE_BLKP(bp)))
-#define GET_PREV_FREE_BLK(bp) GET((uintptr_t)(LOCATION_PREV_FREE_BLKP(bp)))
+/* find_fit looks at this many of the blocks freed last before moving on */
+#define FIT_SCAN_MAX	64
+
+/* The slot map starts with 1 << SLOT_MAP_BITS entries and doubles when half of them are used */
+#define SLOT_MAP_BITS	6
+
+/* The slot map key of free block bp, never 0 since the prologue comes first */
+#define SLOT_KEY(bp)	((uint32_t)(((char *)(bp) - free_slot_base) / DSIZE))
+
+/* Room for this many blocks is added to a segregated list when it fills up */
+#define FREE_LIST_GROW	8
 
 
 void* heap_listp = NULL;
 
-/* ptr to the segregated list */
-#define FREE_SIZE_BUCKETS 17
-void* segregated_list[FREE_SIZE_BUCKETS];
+/*
+ * One segregated list; blocks[i] is a free block of units[i] * DSIZE
+ * bytes. No block is bigger than max_size, though it can be stale.
+ */
+typedef struct {
+	char **blocks;
+	uint32_t *units;
+	size_t count;
+	size_t cap;
+	size_t max_size;
+} free_list_t;
+
+/* the segregated lists, FREE_SIZE_BUCKETS comes from mm_size_classes.h */
+free_list_t segregated_list[FREE_SIZE_BUCKETS];
+
+/* list index of each block size up to CLASS_LOOKUP_MAX, indexed by size/DSIZE */
+unsigned char size_class_lookup[CLASS_LOOKUP_MAX / DSIZE + 1];
+int size_class_lookup_built = 0;
+
+/*
+ * The slot map: the index in its segregated list of every free block,
+ * in a hash table with linear probing keyed on the block's offset in
+ * DSIZE units from free_slot_base (memlib's heap is far below the 64GB
+ * that fit in 32 bits). Unused entries have key 0. It grows with the
+ * number of free blocks rather than with the heap.
+ */
+typedef struct {
+	uint32_t key;
+	uint32_t slot;
+} free_slot_t;
+
+free_slot_t *free_slot_map = NULL;
+size_t free_slot_len = 0;               /* entries, a power of 2 */
+size_t free_slot_used = 0;
+int free_slot_shift = 0;                /* 32 - log2(free_slot_len) */
+char *free_slot_base = NULL;
+
+/* number of blocks split by place, reported by mm_get_stats */
+size_t split_count = 0;
+
+/*
+ * Lowest heap address that has not been written since extend_heap
+ * cleared it. memlib's heap is one large malloc that may well be dirty,
+ * so extend_heap zeroes memory the first time the heap grows over it,
+ * and mm_calloc only has to clear the part of a block below this mark.
+ * It is not reset by mm_init, since mem_reset_brk hands the same dirty
+ * memory back.
+ */
+char *heap_clean_lo = NULL;
+
+/*
+ * The region of each lifetime hint: the chunk it currently bump
+ * allocates from, and its freed objects, free[osize / DSIZE] holding
+ * those of osize bytes
+ */
+typedef struct {
+	char *chunk;
+	char *top;
+	char *end;
+	char *free[REGION_CLASSES];
+} lifetime_region_t;
+
+lifetime_region_t lifetime_regions[MM_HINT_AUTO];
+
+/* A block MM_HINT_AUTO is watching, born when lifetime_clock was birth */
+typedef struct {
+	char *bp;
+	int list;
+	size_t birth;
+} lifetime_sample_t;
+
+lifetime_sample_t lifetime_samples[LIFETIME_SLOTS];
+size_t lifetime_clock = 0;              /* bytes handed out through MM_HINT_AUTO */
+int lifetime_countdown = LIFETIME_RATE;
+
+/* average observed lifetime for each segregated list, kept across mm_init */
+double lifetime_avg[FREE_SIZE_BUCKETS];
+int lifetime_observed[FREE_SIZE_BUCKETS];
+
+#ifdef MM_SIZE_HISTOGRAM
+/*
+ * block sizes of the requests made through mm_malloc and mm_malloc_hint,
+ * indexed by size/DSIZE; bigger sizes share the last slot. The region
+ * chunks the allocator takes for itself are not counted.
+ */
+size_t size_histogram[HIST_MAX_SIZE / DSIZE + 1];
+#endif
 /**********************************************************
  * mm_init
  * Initialize the heap, including "allocation" of the
@@ -102,20 +291,40 @@ void* segregated_list[FREE_SIZE_BUCKETS];
 int mm_init(void)
 {
 	//free_listp = NULL;
+	if (heap_clean_lo == NULL)
+		heap_clean_lo = mem_heap_lo();
+	//the free blocks went away with the old heap
+	free_slot_base = mem_heap_lo();
+	if(free_slot_len == 0)
+		free_slot_grow();
+	memset(free_slot_map, 0, free_slot_len * sizeof(free_slot_t));
+	free_slot_used = 0;
 	if ((heap_listp = mem_sbrk(4*WSIZE)) == (void *)-1)
 		return -1;
+	heap_clean_lo = MAX(heap_clean_lo, (char *)heap_listp + 4*WSIZE);
 	PUT(heap_listp, 0);                         // alignment padding
 	PUT(heap_listp + (1 * WSIZE), PACK(DSIZE, 1));   // prologue header
 	PUT(heap_listp + (2 * WSIZE), PACK(DSIZE, 1));   // prologue footer
 	PUT(heap_listp + (3 * WSIZE), PACK(0, 1));    // epilogue header
 	heap_listp += DSIZE;
 
-	//initialize your segregated lists
+	//initialize your segregated lists, keeping the arrays for reuse
 	int i;
+	if(!size_class_lookup_built)
+		build_class_lookup();
 	for(i = 0; i < FREE_SIZE_BUCKETS; i++)
 	{
-		segregated_list[i] = NULL;
+		segregated_list[i].count = 0;
+		segregated_list[i].max_size = 0;
 	}
+	split_count = 0;
+
+	//regions and watched blocks went away with the old heap
+	memset(lifetime_regions, 0, sizeof(lifetime_regions));
+	memset(lifetime_samples, 0, sizeof(lifetime_samples));
+
+	//the sampled blocks went away with the old heap
+	mm_prof_reset();
 
 	return 0;
 }
@@ -184,171 +393,241 @@ void *coalesce(void *bp)
 /**********************************************************
  * get_segregated_list_ptr 
  * calculates the address of the appropriate segeregated 
- * list ptr
+ * list
  **********************************************************/
 void *get_segregated_list_ptr(size_t size)
 {
-	void *bp;
-
 	//get pointer of the appropriate segregated list
 	int index;
 	index = get_segregated_index(size);
 
-	//get the ptr of the segregated list
-	bp = segregated_list[index];
+	return &segregated_list[index];
+}
 
-	return bp;
+/**********************************************************
+ * find_class
+ * Walks the table in mm_size_classes.h for the list that
+ * keeps blocks of size bytes, starting at list index
+ **********************************************************/
+static int find_class(size_t size, int index)
+{
+	//the last list has no upper bound, so stop before it
+	for(; index < FREE_SIZE_BUCKETS - 1; index++)
+	{
+		if(size <= size_class_max[index])
+			break;
+	}
+	return index;
+}
+
+/**********************************************************
+ * build_class_lookup
+ * Fill size_class_lookup from the table in
+ * mm_size_classes.h, once
+ **********************************************************/
+void build_class_lookup(void)
+{
+	size_t i;
+
+	for(i = 0; i <= CLASS_LOOKUP_MAX / DSIZE; i++)
+		size_class_lookup[i] = find_class(i * DSIZE, i ? size_class_lookup[i - 1] : 0);
+	size_class_lookup_built = 1;
 }
 
 /**********************************************************
  * get_segregated_index 
  * calculates the index of the segeregated list based on
- * its size
+ * its size. Block sizes are multiples of DSIZE, so small
+ * ones are looked up directly.
  **********************************************************/
 int get_segregated_index(size_t size)
 {
-	int index;
-	//calculate the index of the appropriate segregated list
-	
+	if(size <= CLASS_LOOKUP_MAX)
+		return size_class_lookup[size / DSIZE];
+	return find_class(size, size_class_lookup[CLASS_LOOKUP_MAX / DSIZE]);
+}
 
-	if(size <= 128)
-	{
-		index = (size/16) - 1;
-		return index;
-	}
-	else if (size < 256)	//max block size 
-		return 8;
-	else if (size < 512)	//max block size 
-		return 9;
-	else if (size < 1024)	//max block size 
-		return 10;
-	else if (size < 2048)	//max block size 
-		return 11;
-	else if (size < 4096)	//max block size 
-		return 12;
-	else if (size < 8192)	//max block size 
-		return 13;
-	else if (size < 16384)	//max block size 
-		return 14;
-	else if (size < 32768)	//max block size 
-		return 15;
-	else	//for blocks of larger sizes
-		return 16;
 
-}
+/**********************************************************
+ * free_slot_hash
+ * Where the slot map starts looking for key: the top bits
+ * of a multiply, xorshift, multiply mix. Free blocks often
+ * sit a fixed stride apart, which one multiply alone can
+ * send to neighbouring entries (binary-bal's 34 * DSIZE
+ * stride does with the golden ratio).
+ **********************************************************/
+static inline size_t free_slot_hash(uint32_t key)
+{
+	uint32_t h = key * 0x85ebca6bu;
 
+	h ^= h >> 13;
+	return (uint32_t)(h * 0xc2b2ae35u) >> free_slot_shift;
+}
 
 /**********************************************************
- * add_to_free_list
- * adds the free block to the free list
+ * free_slot_find
+ * Index of free block bp in the slot map, or of the unused
+ * entry it would go in
  **********************************************************/
-void add_to_free_list(void *bp)
+static inline size_t free_slot_find(void *bp)
 {
-//	printf("IN ADD_TO_FREE_LIST\n");
-//	printf("adding free block %p\n",bp);
+	uint32_t key = SLOT_KEY(bp);
+	size_t mask = free_slot_len - 1;
+	size_t i = free_slot_hash(key);
 
-	//get the size of the free block
-	size_t size = GET(HDRP(bp));
-	
-	int i = get_segregated_index(size);
+	while(free_slot_map[i].key != 0 && free_slot_map[i].key != key)
+		i = (i + 1) & mask;
+	return i;
+}
 
-	//print_ptr(bp);
-	if(segregated_list[i] == NULL)
+/**********************************************************
+ * free_slot_grow
+ * Double the slot map (or make the first one) and put the
+ * blocks back in
+ **********************************************************/
+void free_slot_grow(void)
+{
+	free_slot_t *old = free_slot_map;
+	size_t i, j, len = free_slot_len;
+
+	free_slot_len = len ? 2 * len : (size_t)1 << SLOT_MAP_BITS;
+	free_slot_shift = len ? free_slot_shift - 1 : 32 - SLOT_MAP_BITS;
+	if((free_slot_map = calloc(free_slot_len, sizeof(free_slot_t))) == NULL)
 	{
-		//add the free block to the free list which is NULL
-		segregated_list[i] = bp;
+		fprintf(stderr, "ERROR: out of memory for the slot map...\n");
+		exit(1);
+	}
 
-		//set the previous as 0 or (null/nothing)
-		PUT(LOCATION_PREV_FREE_BLKP(bp),0);
+	for(i = 0; i < len; i++)
+	{
+		if(old[i].key == 0)
+			continue;
+		for(j = free_slot_hash(old[i].key); free_slot_map[j].key != 0; j = (j + 1) & (free_slot_len - 1))
+			;
+		free_slot_map[j] = old[i];
+	}
+	free(old);
+}
 
-		//set the next free block as 0 or (null/nothing)
-		PUT(LOCATION_NEXT_FREE_BLKP(bp),0);
+/**********************************************************
+ * free_slot_put
+ * Record that free block bp is at slot of its list
+ **********************************************************/
+static inline void free_slot_put(void *bp, uint32_t slot)
+{
+	size_t i;
 
-	}
-	else
+	if(2 * (free_slot_used + 1) > free_slot_len)
+		free_slot_grow();
+	i = free_slot_find(bp);
+	if(free_slot_map[i].key == 0)
 	{
-		if(GET_SIZE(HDRP(segregated_list[i]))>GET_SIZE(HDRP(bp))){
+		free_slot_map[i].key = SLOT_KEY(bp);
+		free_slot_used++;
+	}
+	free_slot_map[i].slot = slot;
+}
 
-			if(GET_NEXT_FREE_BLK(segregated_list[i])!=0)
-			{
-		//	print_seg(1);
-//				void* sec_ptr = GET_NEXT_FREE_BLK(segregated_list[i]);
-				PUT(LOCATION_NEXT_FREE_BLKP(bp),GET_NEXT_FREE_BLK(segregated_list[i]));
-				PUT(GET_PREV_FREE_BLK(LOCATION_NEXT_FREE_BLKP(segregated_list[i])),bp);
-				PUT(LOCATION_NEXT_FREE_BLKP(segregated_list[i]),bp);				
-				PUT(LOCATION_PREV_FREE_BLKP(bp),segregated_list[i]);
-				//printf("test esfewfe\n");
-			//	print_ptr(bp);
-			//	print_ptr(segregated_list[i]);
-//print_seg(1);				
-				
-			}else{
-						//printf("test2\n");
-			//we only have 1 block in the list
-				PUT(LOCATION_NEXT_FREE_BLKP(segregated_list[i]),bp);
-				PUT(LOCATION_PREV_FREE_BLKP(bp),segregated_list[i]);
-				PUT(LOCATION_PREV_FREE_BLKP(segregated_list[i]),0);
-				PUT(LOCATION_NEXT_FREE_BLKP(bp),0);			
-			}
-			
-			
-		}else
+/**********************************************************
+ * free_slot_delete
+ * Drop entry i of the slot map. The entries after it that
+ * were pushed past their place move back, so lookups never
+ * stop early at the hole.
+ **********************************************************/
+static inline void free_slot_delete(size_t i)
+{
+	size_t mask = free_slot_len - 1;
+	size_t j;
+
+	for(j = (i + 1) & mask; free_slot_map[j].key != 0; j = (j + 1) & mask)
+	{
+		if(((j - free_slot_hash(free_slot_map[j].key)) & mask) >= ((j - i) & mask))
 		{
-			//Set the next block of the new head as the previous head
-			PUT(LOCATION_NEXT_FREE_BLKP(bp),segregated_list[i]);
+			free_slot_map[i] = free_slot_map[j];
+			i = j;
+		}
+	}
+	free_slot_map[i].key = 0;
+	free_slot_used--;
+}
 
-			//Set the previous block of the new head as NULL
-			PUT(LOCATION_PREV_FREE_BLKP(bp), 0);
+/**********************************************************
+ * add_to_free_list
+ * adds the free block to the end of its segregated list
+ **********************************************************/
+void add_to_free_list(void *bp)
+{
+	//get the size of the free block
+	size_t size = GET_SIZE(HDRP(bp));
+	free_list_t *list = &segregated_list[get_segregated_index(size)];
 
-			//Set the previous block of the previous head to the new head
-			PUT(LOCATION_PREV_FREE_BLKP(segregated_list[i]),bp);
+	if(list->count == list->cap)
+	{
+		size_t cap = list->cap + MAX(list->cap, FREE_LIST_GROW);
+		char **blocks = realloc(list->blocks, cap * sizeof(char *));
+		uint32_t *units = blocks ? realloc(list->units, cap * sizeof(uint32_t)) : NULL;
 
-			segregated_list[i] = bp;
+		if(units == NULL)
+		{
+			fprintf(stderr, "ERROR: out of memory for the segregated lists...\n");
+			exit(1);
 		}
+		list->blocks = blocks;
+		list->units = units;
+		list->cap = cap;
 	}
+
+	list->blocks[list->count] = bp;
+	list->units[list->count] = SIZE_UNITS(size);
+	list->max_size = MAX(list->max_size, size);
+	free_slot_put(bp, list->count);
+	list->count++;
 }
 
 /**********************************************************
- * add_to_free_list
- * Removes one free block (pointed by bp) from the list
- * since it is being coalesced.
+ * remove_free_block
+ * Removes one free block (pointed by bp) from its list,
+ * either because it is being allocated or coalesced. The
+ * last block of the list moves into its slot.
  **********************************************************/
 void remove_free_block(void *bp)
 {
-//	printf("IN REMOVE_FREE_BLOCK\n");
-//	printf("previous free blk is %p\n",GET_PREV_FREE_BLK(bp));
-//	printf("next free blk is %p\n",GET_NEXT_FREE_BLK(bp));
-
 	size_t size = GET_SIZE(HDRP(bp));	//get the size of the free block
-	int i = get_segregated_index(size);
+	free_list_t *list = &segregated_list[get_segregated_index(size)];
+	size_t i = free_slot_find(bp);
+	size_t slot = free_slot_map[i].slot;
+	size_t last = --list->count;
 
-	if(!GET_PREV_FREE_BLK(bp) && !GET_NEXT_FREE_BLK(bp))	// case 1 - just one block in the free list
+	free_slot_delete(i);
+	if(slot != last)
 	{
-		segregated_list[i] = NULL;
+		list->blocks[slot] = list->blocks[last];
+		list->units[slot] = list->units[last];
+		free_slot_map[free_slot_find(list->blocks[slot])].slot = slot;
 	}
-	else if(!GET_PREV_FREE_BLK(bp) && GET_NEXT_FREE_BLK(bp))// case 2 - removing the head
-	{
-		//set the previous ptr of the new head to 0 (nil/nothing)
-		//printf("location of prev free blk of next blk is %p\n",LOCATION_PREV_FREE_BLKP(GET_NEXT_FREE_BLK(bp)));
+}
 
-		PUT(LOCATION_PREV_FREE_BLKP(GET_NEXT_FREE_BLK(bp)),0);
+/**********************************************************
+ * clear_fresh
+ * Zero heap memory the first time the heap grows over it.
+ * Whole pages are swapped for fresh zero pages with
+ * madvise, so big extensions are not touched until used.
+ **********************************************************/
+static void clear_fresh(char *lo, char *hi)
+{
+#ifdef __linux__
+	size_t page = mem_pagesize();
+	char *page_lo = (char *)(((uintptr_t)lo + page - 1) & ~(uintptr_t)(page - 1));
+	char *page_hi = (char *)((uintptr_t)hi & ~(uintptr_t)(page - 1));
 
-		//set the head of the free list to the next block
-		segregated_list[i] = GET_NEXT_FREE_BLK(bp);
-	}
-	else if(GET_PREV_FREE_BLK(bp) && !GET_NEXT_FREE_BLK(bp))// case 3 - removing the last node in list
+	if (page_hi > page_lo && madvise(page_lo, page_hi - page_lo, MADV_DONTNEED) == 0)
 	{
-		//set the next location of the previous block to 0
-		PUT(LOCATION_NEXT_FREE_BLKP(GET_PREV_FREE_BLK(bp)),0);
+		memset(lo, 0, page_lo - lo);
+		memset(page_hi, 0, hi - page_hi);
+		return;
 	}
-	else if(GET_PREV_FREE_BLK(bp) && GET_NEXT_FREE_BLK(bp))// case 4
-	{
-		//set the next location of the previous block
-		PUT(LOCATION_NEXT_FREE_BLKP(GET_PREV_FREE_BLK(bp)),GET_NEXT_FREE_BLK(bp));
-
-		//set the previous location of the next block
-		PUT(LOCATION_PREV_FREE_BLKP(GET_NEXT_FREE_BLK(bp)),GET_PREV_FREE_BLK(bp));
-	};
+#endif
+	memset(lo, 0, hi - lo);
 }
 
 /**********************************************************
@@ -366,6 +645,11 @@ void *extend_heap(size_t words)
 	size = (words % 2) ? (words+1) * WSIZE : words * WSIZE;
 	if ( (bp = mem_sbrk(size)) == (void *)-1 )
 		return NULL;
+	if (bp + size > heap_clean_lo)
+	{
+		clear_fresh(MAX(bp, heap_clean_lo), bp + size);
+		heap_clean_lo = bp + size;
+	}
 
 	/* Initialize free block header/footer and the epilogue header */
 	PUT(HDRP(bp), PACK(size, 0));                // free block header
@@ -376,58 +660,204 @@ void *extend_heap(size_t words)
 	return bp;
 }
 
+/**********************************************************
+ * align_heap_top
+ * Pad the heap with a free block so the next block that
+ * extend_heap returns starts on a page boundary
+ **********************************************************/
+void align_heap_top(void)
+{
+	size_t page = mem_pagesize();
+	size_t pad = (page - ((uintptr_t)mem_heap_hi() + 1) % page) % page;
+	void *bp;
+
+	if (pad == 0)
+		return;
+	/* the pad has to hold a minimum sized block */
+	if (pad < 2 * DSIZE)
+		pad += page;
+	if ((bp = extend_heap(pad/WSIZE)) != NULL)
+		coalesce(bp);
+}
+
+/**********************************************************
+ * page_pad
+ * Bytes split_to_page splits off the front of block bp;
+ * a pad has to hold a minimum sized block
+ **********************************************************/
+size_t page_pad(void *bp)
+{
+	size_t page = mem_pagesize();
+	size_t pad = (page - (uintptr_t)bp % page) % page;
+
+	if (pad != 0 && pad < 2 * DSIZE)
+		pad += page;
+	return pad;
+}
+
+/**********************************************************
+ * split_to_page
+ * Split the front off free block bp so that the rest starts
+ * on a page boundary. The front goes back on the free list.
+ * Returns the page aligned block, which is not on any list.
+ **********************************************************/
+void *split_to_page(void *bp)
+{
+	size_t pad = page_pad(bp);
+	size_t bsize = GET_SIZE(HDRP(bp));
+
+	if (pad == 0)
+		return bp;
+
+	PUT(HDRP(bp), PACK(pad, 0));
+	PUT(FTRP(bp), PACK(pad, 0));
+	add_to_free_list(bp);
+
+	bp = (char *)bp + pad;
+	PUT(HDRP(bp), PACK(bsize - pad, 0));
+	PUT(FTRP(bp), PACK(bsize - pad, 0));
+	return bp;
+}
+
 /**********************************************************
  * find_fit
- * Traverse the heap searching for a block to fit asize
+ * Scan the sizes of the last limit blocks of one segregated
+ * list, the ones freed most recently, for the smallest that
+ * fits asize, stopping at one that place() will not split.
+ * With SSE2 the sizes are compared 4 at a time.
  * Return NULL if no free blocks can handle that size
  * Assumed that asize is aligned	
  **********************************************************/
-void * find_fit(size_t asize, void * free_listp)
+void * find_fit(size_t asize, free_list_t *list, size_t limit)
 {
-	void *bp;
+	const uint32_t *units = list->units;
+	uint32_t a = SIZE_UNITS(asize);
+	/* units - a wraps around for blocks that are too small, so the best fit has the smallest key */
+	uint32_t key, best_key = 0 - a;
+	size_t stop = list->count > limit ? list->count - limit : 0;
+	size_t i = list->count;
+
+#ifdef __SSE2__
+	if(i >= stop + 4)
+	{
+		//flip the sign bits so the signed compares order the keys as unsigned
+		__m128i bias = _mm_set1_epi32(INT32_MIN);
+		__m128i va = _mm_set1_epi32(a);
+		__m128i good = _mm_set1_epi32(INT32_MIN + 2);
+		__m128i best = _mm_set1_epi32(best_key ^ 0x80000000u);
+		uint32_t lanes[4];
+		int j;
+
+		for(; i >= stop + 4; i -= 4)
+		{
+			__m128i k = _mm_xor_si128(_mm_sub_epi32(_mm_loadu_si128((const __m128i *)(units + i - 4)), va), bias);
+			__m128i lt = _mm_cmplt_epi32(k, best);
 
-	//check if your free list is empty
-	if(free_listp == NULL)
-		return NULL;
-	
-	if(asize <= GET_SIZE(HDRP(free_listp)))
-		return free_listp;
-	else
-		return NULL;
+			best = _mm_or_si128(_mm_and_si128(lt, k), _mm_andnot_si128(lt, best));
+			if(_mm_movemask_epi8(_mm_cmplt_epi32(k, good)))
+			{
+				i = stop;	//a block that needs no split, look no further
+				break;
+			}
+		}
+		_mm_storeu_si128((__m128i *)lanes, best);
+		for(j = 0; j < 4; j++)
+			best_key = MIN(best_key, lanes[j] ^ 0x80000000u);
+	}
+#endif
+
+	for(; i > stop && best_key >= 2; i--)
+	{
+		key = units[i - 1] - a;
+		best_key = MIN(best_key, key);
+	}
 
+	if(best_key == 0 - a)
+		return NULL;
+	for(i = list->count - 1; units[i] - a != best_key; i--)
+		;
+	return list->blocks[i];
 }
 
 /**********************************************************
- * find_fit
- * Traverse the heap searching for a block to fit asize
+ * find_segregated_best_fit
+ * Best fit among the last FIT_SCAN_MAX blocks of the list
+ * asize belongs to. When none of them fits and the list
+ * may still hold a block big enough (max_size), the rest of
+ * it is scanned too. Only then is it the best fit among
+ * the last FIT_SCAN_MAX blocks of the first list above it
+ * that is not empty, where every block is big enough.
  * Return NULL if no free blocks can handle that size
  * Assumed that asize is aligned	
  **********************************************************/
 void * find_segregated_best_fit(size_t asize)
 {
-		//get the segregated index
+	//get the segregated index
 	int segregated_index = get_segregated_index(asize);
+	free_list_t *fit_list = &segregated_list[segregated_index];
+	void *free_blk;
 
-	//traverse through each segregated list
-	int i;
-	for(i = segregated_index; i < 31; i++)
+	//skip asize's list when none of it can fit
+	if(fit_list->max_size >= asize)
 	{
-		//free segregated list
-		void * free_segregated_list = segregated_list[i];
+		if((free_blk = find_fit(asize, fit_list, FIT_SCAN_MAX)) != NULL)
+			return free_blk;
+		if(fit_list->count > FIT_SCAN_MAX && (free_blk = find_fit(asize, fit_list, SIZE_MAX)) != NULL)
+			return free_blk;
+		fit_list->max_size = asize - DSIZE;	//every block is smaller
+	}
 
-		//get one free blk
-		void * free_blk = find_fit(asize,free_segregated_list);
+	//traverse through the bigger segregated lists
+	int i;
+	for(i = segregated_index + 1; i < FREE_SIZE_BUCKETS; i++)
+	{
+		free_list_t *list = &segregated_list[i];
 
-		if(free_blk != NULL)
-			return free_blk;
-		else	
-			continue;
+		if(list->count > 0)
+			return find_fit(asize, list, FIT_SCAN_MAX);
 	}
 
 	//if no free blk is found
 	return NULL;
 }
 
+/**********************************************************
+ * find_page_fit
+ * Like find_segregated_best_fit, for blocks that have to
+ * start on a page: a block fits when asize still fits
+ * after its page_pad. Blocks this big are rare, so every
+ * list from asize's up is scanned.
+ * Return NULL if no free blocks can handle that size
+ **********************************************************/
+void * find_page_fit(size_t asize)
+{
+	int i;
+	size_t j, best_size;
+	void *best;
+
+	for(i = get_segregated_index(asize); i < FREE_SIZE_BUCKETS; i++)
+	{
+		free_list_t *list = &segregated_list[i];
+
+		best = NULL;
+		best_size = SIZE_MAX;
+		for(j = 0; j < list->count; j++)
+		{
+			size_t need = asize + page_pad(list->blocks[j]);
+			size_t bsize = (size_t)list->units[j] * DSIZE;
+
+			if(bsize >= need && bsize < best_size)
+			{
+				best = list->blocks[j];
+				best_size = bsize;
+			}
+		}
+		if(best != NULL)
+			return best;
+	}
+	return NULL;
+}
+
 /**********************************************************
  * place
  * Mark the block as allocated
@@ -446,11 +876,12 @@ void place(void* bp, size_t asize)
 		PUT(FTRP(bp),PACK(asize,1));
 		/* second block - which will be freed*/
 		//header
-		PUT((bp+asize-WSIZE),PACK(bsize-asize,0));
+		PUT((bp+asize-WSIZE),PACK(bsize-asize,0) | SPLIT_BIT);
 		//footer
 		PUT(FTRP(bp+asize),PACK(bsize-asize,0));
 		//add the second block to the free list
 		add_to_free_list(bp+asize);
+		split_count++;
 	}
 	else	//if splitting is not possible
 	{
@@ -471,6 +902,16 @@ void mm_free(void *bp)
 		return;
 	}
 
+	if(GET_SAMPLED(HDRP(bp)))
+		mm_prof_record_free(bp);
+
+	if(GET_REGION(HDRP(bp))){
+		region_free(bp);
+		return;
+	}
+	if(GET_LIFETIME(HDRP(bp)))
+		lifetime_record_free(bp);
+
 	size_t size = GET_SIZE(HDRP(bp));
 	PUT(HDRP(bp), PACK(size,0));
 	PUT(FTRP(bp), PACK(size,0));
@@ -482,14 +923,16 @@ void mm_free(void *bp)
 }
 
 /**********************************************************
- * mm_malloc
+ * heap_malloc
  * Allocate a block of size bytes.
  * The type of search is determined by find_fit
  * The decision of splitting the block, or not is determined
  *   in place(..)
  * If no block satisfies the request, the heap is extended
+ * The allocator's own blocks come from here directly, so
+ * neither the profiler nor the size histogram sees them.
  **********************************************************/
-void *mm_malloc(size_t size)
+void *heap_malloc(size_t size)
 {
 	//mm_check();
 	//print_seg(0);
@@ -498,8 +941,8 @@ void *mm_malloc(size_t size)
     size_t extendsize; /* amount to extend heap if no fit */
     char * bp;
 
-    /* Ignore spurious requests */
-    if (size == 0)
+    /* Ignore spurious requests, and ones no block could hold */
+    if (size == 0 || size > MAX_REQUEST)
         return NULL;
 
     /* Adjust block size to include overhead and alignment reqs. */
@@ -508,17 +951,22 @@ void *mm_malloc(size_t size)
     else
         asize = DSIZE * ((size + (DSIZE) + (DSIZE-1))/ DSIZE);
 
-    /* Search the free list for a fit */
-    if ((bp = find_segregated_best_fit(asize)) != NULL) {
+    /* Search the free list for a fit, large blocks need room to be page aligned */
+    bp = asize >= REMAP_MIN ? find_page_fit(asize) : find_segregated_best_fit(asize);
+    if (bp != NULL) {
 
     	//printf("free size found, bp is %p\n",bp);
     	remove_free_block(bp);
+        if (asize >= REMAP_MIN)
+            bp = split_to_page(bp);
         place(bp, asize);
         return bp;
     };
 
     /* No fit found. Get more memory and place the block */
     extendsize = MAX(asize, CHUNKSIZE);
+    if (asize >= REMAP_MIN)
+        align_heap_top();
     if ((bp = extend_heap(extendsize/WSIZE)) == NULL)
     {
         return NULL;
@@ -528,6 +976,357 @@ void *mm_malloc(size_t size)
 
 }
 
+/**********************************************************
+ * record_size
+ * Count a request of size bytes in the size histogram, by
+ * the block size heap_malloc would give it
+ **********************************************************/
+static inline void record_size(size_t size)
+{
+#ifdef MM_SIZE_HISTOGRAM
+    size_t asize;
+
+    if (size == 0 || size > MAX_REQUEST)
+        return;
+    asize = (size <= DSIZE) ? 2 * DSIZE : DSIZE * ((size + (DSIZE) + (DSIZE-1))/ DSIZE);
+    size_histogram[MIN(asize, HIST_MAX_SIZE) / DSIZE]++;
+#endif
+}
+
+/**********************************************************
+ * mm_malloc
+ * Allocate a block of size bytes from the heap, counting
+ * it towards the next profiler sample and in the size
+ * histogram
+ **********************************************************/
+void *mm_malloc(size_t size)
+{
+    char *bp;
+
+    record_size(size);
+    if ((bp = heap_malloc(size)) != NULL)
+        PROF_ALLOC(bp, size);
+    return bp;
+}
+
+/**********************************************************
+ * region_unlink
+ * Take freed object bp off its region's free list
+ *********************************************************/
+static void region_unlink(lifetime_region_t *r, char *bp)
+{
+	char **head = &r->free[GET_SIZE(HDRP(bp)) / DSIZE];
+
+	if(REGION_PREV(bp) != NULL)
+		REGION_NEXT(REGION_PREV(bp)) = REGION_NEXT(bp);
+	else
+		*head = REGION_NEXT(bp);
+	if(REGION_NEXT(bp) != NULL)
+		REGION_PREV(REGION_NEXT(bp)) = REGION_PREV(bp);
+}
+
+/**********************************************************
+ * region_empty_chunk
+ * Every object in chunk is dead and on the free lists; take
+ * them off. The current chunk starts over, an older one
+ * goes back to the heap.
+ *********************************************************/
+static void region_empty_chunk(lifetime_region_t *r, char *chunk)
+{
+	char *top = (chunk == r->chunk) ? r->top : CHUNK_TOP(chunk);
+	char *p;
+
+	for(p = chunk + CHUNK_HDR; p < top; p += GET_SIZE(p + WSIZE))
+		region_unlink(r, p + DSIZE);
+
+	if(chunk == r->chunk)
+		r->top = chunk + CHUNK_HDR;
+	else
+		mm_free(chunk);
+}
+
+/**********************************************************
+ * region_new_chunk
+ * Start a new chunk for region r. The old one keeps its
+ * live objects and the freed ones on the free lists until
+ * all of them are dead.
+ * Returns 0 if the heap could not be extended.
+ *********************************************************/
+static int region_new_chunk(lifetime_region_t *r, int hint)
+{
+	char *chunk;
+
+	//chunks are not user allocations, keep them out of the profile
+	if((chunk = heap_malloc(REGION_CHUNK - DSIZE)) == NULL)
+		return 0;
+	if(r->chunk != NULL)
+		CHUNK_TOP(r->chunk) = r->top;
+
+	CHUNK_LIVE(chunk) = 0;
+	CHUNK_HINT(chunk) = hint;
+	r->chunk = chunk;
+	r->top = chunk + CHUNK_HDR;
+	r->end = chunk + GET_SIZE(HDRP(chunk)) - DSIZE;
+	return 1;
+}
+
+/**********************************************************
+ * region_malloc
+ * Reuse a freed object of the same size from the region of
+ * the given hint, or else bump allocate a new one. Objects
+ * have a two word header: their chunk, then the usual
+ * size/alloc word with REGION_BIT set.
+ *********************************************************/
+static void *region_malloc(size_t size, int hint)
+{
+	lifetime_region_t *r = &lifetime_regions[hint];
+	size_t osize = DSIZE * ((size + (DSIZE) + (DSIZE-1))/ DSIZE);
+	char *bp;
+
+	record_size(size);
+	if((bp = r->free[osize / DSIZE]) != NULL)
+	{
+		region_unlink(r, bp);
+	}
+	else
+	{
+		if(r->chunk == NULL || r->top + osize > r->end)
+		{
+			if(!region_new_chunk(r, hint))
+				return NULL;
+		}
+
+		bp = r->top + DSIZE;
+		OBJ_CHUNK(bp) = r->chunk;
+		r->top += osize;
+	}
+
+	PUT(HDRP(bp), PACK(osize, 1) | REGION_BIT);
+	CHUNK_LIVE(OBJ_CHUNK(bp))++;
+
+	PROF_ALLOC(bp, size);
+	return bp;
+}
+
+/**********************************************************
+ * region_free
+ * Put a region object on its region's free list for reuse.
+ * Once all objects of its chunk are dead, the chunk is
+ * emptied instead.
+ *********************************************************/
+void region_free(void *bp)
+{
+	char *chunk = OBJ_CHUNK(bp);
+	lifetime_region_t *r = &lifetime_regions[CHUNK_HINT(chunk)];
+	size_t osize = GET_SIZE(HDRP(bp));
+	char **head = &r->free[osize / DSIZE];
+
+	PUT(HDRP(bp), PACK(osize, 0) | REGION_BIT);
+	REGION_PREV(bp) = NULL;
+	REGION_NEXT(bp) = *head;
+	if(*head != NULL)
+		REGION_PREV(*head) = bp;
+	*head = bp;
+
+	if(--CHUNK_LIVE(chunk) == 0)
+		region_empty_chunk(r, chunk);
+}
+
+/**********************************************************
+ * region_realloc
+ * Grow a region object into a new one with the same hint
+ *********************************************************/
+static void *region_realloc(void *ptr, size_t size)
+{
+	size_t payload = GET_SIZE(HDRP(ptr)) - DSIZE;
+	void *newptr;
+
+	if(size <= payload)
+		return ptr;
+	if((newptr = mm_malloc_hint(size, CHUNK_HINT(OBJ_CHUNK(ptr)))) == NULL)
+		return NULL;
+	memcpy(newptr, ptr, payload);
+	mm_free(ptr);
+	return newptr;
+}
+
+/**********************************************************
+ * lifetime_observe
+ * Fold one observed lifetime into the running average of
+ * its segregated list
+ *********************************************************/
+static void lifetime_observe(int list, size_t age)
+{
+	int n = MIN(lifetime_observed[list], 15) + 1;
+
+	lifetime_avg[list] += ((double)age - lifetime_avg[list]) / n;
+	lifetime_observed[list]++;
+}
+
+/**********************************************************
+ * lifetime_forget
+ * Stop watching slot i, counting its block as having lived
+ * at least as long as it has so far
+ *********************************************************/
+static void lifetime_forget(int i)
+{
+	char *bp = lifetime_samples[i].bp;
+
+	lifetime_observe(lifetime_samples[i].list, lifetime_clock - lifetime_samples[i].birth);
+	PUT(HDRP(bp), GET(HDRP(bp)) & ~(uintptr_t)LIFETIME_BIT);
+	lifetime_samples[i].bp = NULL;
+}
+
+/**********************************************************
+ * lifetime_watch
+ * Start watching a block allocated from the default heap.
+ * Blocks that have already outlived LONG_LIFETIME are let
+ * go first, so long lived sizes are learnt without waiting
+ * for them to die. When every slot is still taken, the
+ * oldest block is let go.
+ *********************************************************/
+static void lifetime_watch(char *bp, int list)
+{
+	int i, slot = -1, oldest = 0;
+
+	for(i = 0; i < LIFETIME_SLOTS; i++)
+	{
+		if(lifetime_samples[i].bp != NULL
+				&& lifetime_clock - lifetime_samples[i].birth > LONG_LIFETIME)
+			lifetime_forget(i);
+
+		if(lifetime_samples[i].bp == NULL)
+		{
+			if(slot < 0)
+				slot = i;
+		}
+		else if(lifetime_samples[i].birth < lifetime_samples[oldest].birth
+				|| lifetime_samples[oldest].bp == NULL)
+			oldest = i;
+	}
+	if(slot < 0)
+	{
+		lifetime_forget(oldest);
+		slot = oldest;
+	}
+
+	lifetime_samples[slot].bp = bp;
+	lifetime_samples[slot].list = list;
+	lifetime_samples[slot].birth = lifetime_clock;
+	PUT(HDRP(bp), GET(HDRP(bp)) | LIFETIME_BIT);
+}
+
+/**********************************************************
+ * lifetime_record_free
+ * A watched block died, record how long it lived
+ *********************************************************/
+void lifetime_record_free(void *bp)
+{
+	int i;
+
+	for(i = 0; i < LIFETIME_SLOTS; i++)
+	{
+		if(lifetime_samples[i].bp == bp)
+		{
+			lifetime_observe(lifetime_samples[i].list, lifetime_clock - lifetime_samples[i].birth);
+			lifetime_samples[i].bp = NULL;
+			return;
+		}
+	}
+}
+
+/**********************************************************
+ * lifetime_predict
+ * Hint for a size from what was observed for its list
+ *********************************************************/
+static int lifetime_predict(int list)
+{
+	if(lifetime_observed[list] < LIFETIME_MIN_SAMPLES)
+		return MM_HINT_UNKNOWN;
+	if(lifetime_avg[list] < SHORT_LIFETIME)
+		return MM_HINT_SHORT;
+	if(lifetime_avg[list] > LONG_LIFETIME)
+		return MM_HINT_LONG;
+	return MM_HINT_UNKNOWN;
+}
+
+/**********************************************************
+ * mm_malloc_hint
+ * Allocate size bytes, keeping objects of like lifetimes
+ * together. Short and long lived objects come from separate
+ * regions of REGION_CHUNK sized chunks, each with its own
+ * free lists, so a long lived object never pins a hole
+ * between short lived ones. MM_HINT_AUTO learns the hint
+ * per segregated list by watching the lifetime of one
+ * allocation in LIFETIME_RATE.
+ * Unknown lifetimes and big objects use the default heap.
+ *********************************************************/
+void *mm_malloc_hint(size_t size, int hint)
+{
+	size_t asize;
+	int list;
+	char *bp;
+
+	if(size == 0 || size > MAX_REQUEST)
+		return NULL;
+
+	if(hint == MM_HINT_AUTO)
+	{
+		asize = (size <= DSIZE) ? 2 * DSIZE : DSIZE * ((size + (DSIZE) + (DSIZE-1))/ DSIZE);
+		list = get_segregated_index(asize);
+		lifetime_clock += size;
+
+		if(--lifetime_countdown == 0)
+		{
+			lifetime_countdown = LIFETIME_RATE;
+			if((bp = mm_malloc(size)) != NULL)
+				lifetime_watch(bp, list);
+			return bp;
+		}
+		hint = lifetime_predict(list);
+	}
+
+	if(REGION_BIT >= DSIZE || size > REGION_MAX
+			|| (hint != MM_HINT_SHORT && hint != MM_HINT_LONG))
+		return mm_malloc(size);
+
+	return region_malloc(size, hint);
+}
+
+/**********************************************************
+ * move_payload
+ * Copy len bytes from src to dst. When both sit at the same
+ * offset within a page, as large blocks do, the whole pages
+ * in between are moved with mremap instead of copied and the
+ * source pages are replaced with fresh ones.
+ *********************************************************/
+static void move_payload(char *dst, char *src, size_t len)
+{
+#ifdef __linux__
+	size_t page = mem_pagesize();
+	char *src_lo = (char *)(((uintptr_t)src + page - 1) & ~(uintptr_t)(page - 1));
+	char *src_hi = (char *)(((uintptr_t)src + len) & ~(uintptr_t)(page - 1));
+	char *dst_lo = dst + (src_lo - src);
+
+	if (len >= REMAP_MIN && ((uintptr_t)dst_lo & (page - 1)) == 0 && src_hi > src_lo
+			&& mremap(src_lo, src_hi - src_lo, src_hi - src_lo,
+					MREMAP_MAYMOVE | MREMAP_FIXED, dst_lo) != MAP_FAILED)
+	{
+		//the old block stays part of the heap, so map its pages back
+		if (mmap(src_lo, src_hi - src_lo, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+		{
+			fprintf(stderr, "ERROR: mmap failed, heap has a hole...\n");
+			exit(1);
+		}
+		memcpy(dst, src, src_lo - src);
+		memcpy(dst_lo + (src_hi - src_lo), src_hi, (src + len) - src_hi);
+		return;
+	}
+#endif
+	memcpy(dst, src, len);
+}
+
 /**********************************************************
  * mm_realloc
  * Implemented simply in terms of mm_malloc and mm_free
@@ -542,6 +1341,13 @@ void *mm_realloc(void *ptr, size_t size)
 	/* If oldptr is NULL, then this is just malloc. */
 	if (ptr == NULL)
 		return (mm_malloc(size));
+	/* Too big to round up to a block size, leave the old block alone */
+	if (size > MAX_REQUEST)
+		return NULL;
+
+	/* Objects in a lifetime region stay in one of the same kind */
+	if(GET_REGION(HDRP(ptr)))
+		return region_realloc(ptr, size);
 
 	size_t asize;
 	/* Adjust block size to include overhead and alignment reqs. */
@@ -552,7 +1358,13 @@ void *mm_realloc(void *ptr, size_t size)
 
 	if(GET_SIZE(HDRP(ptr)) >= asize)
 	{
-		place(ptr,size);	//splitting
+		//place rewrites the header, so account for it as a free and a malloc
+		if(GET_SAMPLED(HDRP(ptr)))
+			mm_prof_record_free(ptr);
+		if(GET_LIFETIME(HDRP(ptr)))
+			lifetime_record_free(ptr);
+		place(ptr,asize);	//splitting
+		PROF_ALLOC(ptr, size);
 		return ptr;	
 	};
 
@@ -583,24 +1395,161 @@ void *mm_realloc(void *ptr, size_t size)
 	if (newptr == NULL)
 		return NULL;
 
-	/* Copy the old data. */
-	copySize = GET_SIZE(HDRP(oldptr));
+	/* Copy (or move) the old payload. */
+	copySize = GET_SIZE(HDRP(oldptr)) - DSIZE;
 	if (size < copySize)
 		copySize = size;
-	memcpy(newptr, oldptr, copySize);
+	move_payload(newptr, oldptr, copySize);
 	mm_free(oldptr);
 	return newptr;
 }
+/**********************************************************
+ * zero_block
+ * Clears len bytes at bp. Big blocks are cleared with
+ * non-temporal stores so they don't flush the cache.
+ *********************************************************/
+static void zero_block(char *bp, size_t len)
+{
+#ifdef __SSE2__
+	if(len >= STREAM_ZERO_MIN)
+	{
+		char *end = bp + len;
+		char *p = (char *)(((uintptr_t)bp + 15) & ~(uintptr_t)15);
+		__m128i zero = _mm_setzero_si128();
+
+		memset(bp, 0, p - bp);
+		for(; p + 64 <= end; p += 64)
+		{
+			_mm_stream_si128((__m128i *)p, zero);
+			_mm_stream_si128((__m128i *)(p + 16), zero);
+			_mm_stream_si128((__m128i *)(p + 32), zero);
+			_mm_stream_si128((__m128i *)(p + 48), zero);
+		}
+		_mm_sfence();
+		memset(p, 0, end - p);
+		return;
+	}
+#endif
+	memset(bp, 0, len);
+}
+
+/**********************************************************
+ * mm_calloc
+ * Allocate zeroed memory for nmemb elements of size bytes.
+ * extend_heap already zeroed memory new to the heap, so
+ * only memory below heap_clean_lo gets cleared.
+ * Returns NULL if nmemb * size overflows, or is too big for
+ * mm_malloc to round up to a block size.
+ *********************************************************/
+void *mm_calloc(size_t nmemb, size_t size)
+{
+	char *clean_lo = heap_clean_lo;
+	char *bp;
+	size_t bytes;
+
+	if(size != 0 && nmemb > SIZE_MAX / size)
+		return NULL;
+	bytes = nmemb * size;
+
+	if((bp = mm_malloc(bytes)) == NULL)
+		return NULL;
+
+	//anything at or above the old mark was zeroed by extend_heap and not touched since
+	if(bp < clean_lo)
+		zero_block(bp, MIN(bytes, (size_t)(clean_lo - bp)));
+	return bp;
+}
+
+/**********************************************************
+ * mm_block_size
+ * Size of the block holding ptr, header and footer included
+ *********************************************************/
+size_t mm_block_size(void *ptr)
+{
+	return GET_SIZE(HDRP(ptr));
+}
+
+/**********************************************************
+ * mm_get_stats
+ * Walk the heap from the prologue to the epilogue and
+ * collect block counts, free bytes per segregated list and
+ * the split remainders that are still free, and add up the
+ * memory the free lists and slot map take outside the heap
+ *********************************************************/
+void mm_get_stats(mm_stats_t *st)
+{
+	void *bp;
+	size_t size;
+	int i;
+
+	memset(st, 0, sizeof(*st));
+	st->heap_size = mem_heapsize();
+	st->bins = FREE_SIZE_BUCKETS;
+	st->splits = split_count;
+	st->slot_map_bytes = free_slot_len * sizeof(free_slot_t);
+	for(i = 0; i < FREE_SIZE_BUCKETS; i++)
+		st->free_list_bytes += segregated_list[i].cap * (sizeof(char *) + sizeof(uint32_t));
+
+	for(bp = NEXT_BLKP(heap_listp); (size = GET_SIZE(HDRP(bp))) > 0; bp = NEXT_BLKP(bp))
+	{
+		if(GET_ALLOC(HDRP(bp)))
+		{
+			st->alloc_blocks++;
+			st->alloc_bytes += size;
+			continue;
+		}
+
+		st->free_blocks++;
+		st->free_bytes += size;
+		st->largest_free = MAX(st->largest_free, size);
+
+		i = get_segregated_index(size);
+		st->bin_free_blocks[i]++;
+		st->bin_free_bytes[i] += size;
+
+		if(GET_SPLIT(HDRP(bp)))
+		{
+			st->split_free_blocks++;
+			st->split_free_bytes += size;
+		}
+	}
+}
+/**********************************************************
+ * mm_dump_size_histogram
+ * Write the block sizes of the requests made through
+ * mm_malloc and mm_malloc_hint as "<size> <count>" lines,
+ * the input format of mmclass -H.
+ * Returns 0 on success, -1 on error or when the allocator
+ * was built without -DMM_SIZE_HISTOGRAM.
+ *********************************************************/
+int mm_dump_size_histogram(const char *filename)
+{
+#ifdef MM_SIZE_HISTOGRAM
+	FILE *fp;
+	size_t i;
 
+	if((fp = fopen(filename, "w")) == NULL)
+		return -1;
+	fprintf(fp, "# block size, count\n");
+	for(i = 0; i <= HIST_MAX_SIZE / DSIZE; i++)
+	{
+		if(size_histogram[i] != 0)
+			fprintf(fp, "%zu %zu\n", i * DSIZE, size_histogram[i]);
+	}
+	return fclose(fp) == 0 ? 0 : -1;
+#else
+	return -1;
+#endif
+}
 
 int exists_in_free_list(size_t address){
 	int i=0;
-	void* bin_ptr=segregated_list;
+	size_t j;
 	for(;i<FREE_SIZE_BUCKETS;i++)
 	{
-		while(GET_NEXT_FREE_BLK(bin_ptr)!=0)
+		for(j=0;j<segregated_list[i].count;j++)
 		{
-			if(address == bin_ptr){
+			if(address == (size_t)segregated_list[i].blocks[j]){
 				return 1;
 			}
 		}
@@ -615,63 +1564,47 @@ Argument "type": will take 3 inputs: '0' '1' '2' they are are to show different
 1 : will show you the size of every element and every sublist
 2 : will also show you the lists that have nothing in them
 */
-void* print_seg(int type)
+void print_seg(int type)
 {
-	void* temp[FREE_SIZE_BUCKETS];
-	
-	if(segregated_list!=NULL){
-		
-		int i=0;
-		
-		printf("Start\n");
-		/*
-		This for loop goes through the array of pointers that hold the buckets of different sized lists			
-		*/
-		for(i=0;i<FREE_SIZE_BUCKETS;i++){
-		
-			if(segregated_list[i]!=NULL){
-		
-				printf("[%d]: ",i);
-				int seg_size=1;
-				
-				temp[i] = segregated_list[i]; 
-				/*
-				This while loop goes through one index in our array of pointers and then applies the appropriate tests
-				*/		
-				while(GET_NEXT_FREE_BLK(temp[i])!=0){
-					
-					if(type>0){printf("-[%d]-",GET_SIZE(HDRP(temp[i])));}
-						seg_size++;
-						temp[i] = GET_NEXT_FREE_BLK(temp[i]);
-				}
-		
-				if(type>0){printf("-[%d]\n",GET_SIZE(HDRP(temp[i])));}
-				
-					printf("size is: %d\n",seg_size);
-				}
-				else
-				{			
-				
-					if(type==3)
-					{
-						printf("NULL\n");
-					}
+	int i=0;
+	size_t j;
+
+	printf("Start\n");
+	/*
+	This for loop goes through the array of segregated lists of different sized blocks
+	*/
+	for(i=0;i<FREE_SIZE_BUCKETS;i++){
+
+		free_list_t *list = &segregated_list[i];
+
+		if(list->count>0){
+
+			printf("[%d]: ",i);
+			if(type>0){
+				for(j=0;j<list->count;j++){
+					printf("-[%zu]",(size_t)list->units[j] * DSIZE);
 				}
+				printf("\n");
+			}
+			printf("size is: %zu\n",list->count);
+		}
+		else if(type==2)
+		{
+			printf("NULL\n");
 		}
-		printf("End\n");	
 	}
-
+	printf("End\n");
 }
 
 /*
 Used for debugging
-takes in a pointer to a block
-Prints out the size of a pointer, what is the previous block it's pointing to and the next pointer it is pointing to
+takes in a pointer to a free block
+Prints out the size of the block and its slot in its segregated list
 */
 void print_ptr(void *bp){
 	
 	if(bp!=NULL){
-		printf("prev is %d, size is %d, next is %d\n",GET_PREV_FREE_BLK(bp),GET_SIZE(HDRP(bp)),GET_NEXT_FREE_BLK(bp));
+		printf("slot is %zu, size is %zu\n",(size_t)GET_FREE_SLOT(bp),(size_t)GET_SIZE(HDRP(bp)));
 	}else
 	{
 		printf("ptr is NULL\n");
@@ -684,83 +1617,50 @@ The int test argment allows the user to print information about a specific test
 */
 int free_list_checks(int test){
 
-	
-	if(segregated_list!=NULL){	printf("free list ptr is at %d\n",segregated_list);}
-
-		if(segregated_list==NULL){
-			/*
-			This for loop goes through the array of pointers that hold the buckets of different sized lists			
-			*/
-			int i=0;
-			for(;i<FREE_SIZE_BUCKETS;i++){
-				
-				if(segregated_list[i]==NULL){
-					continue;			
+	int i=0;
+	size_t j;
+	/*
+	This for loop goes through the array of segregated lists of different sized blocks
+	*/
+	for(;i<FREE_SIZE_BUCKETS;i++){
+
+		free_list_t *list = &segregated_list[i];
+		/*
+		This loop goes through one list and then applies the appropriate tests
+		*/
+		for(j=0;j<list->count;j++){
+
+			char *bin_ptr = list->blocks[j];
+
+			//Valid heap pointers, checked first since the others read the block
+			if(test==3 || test==0){
+
+				if(bin_ptr < (char *)mem_heap_lo() || bin_ptr > (char *)mem_heap_hi()){
+
+					printf("Out of heap\n");
+					return 0;
+				}
+			}
+			//is every block in free list marked as free
+			if(test==0 || test==1){
+				if(GET_ALLOC(HDRP(bin_ptr))!=0)
+				{
+					printf("Block not assigned properly\n");
+					return 0;
 				}
-						
-				void* bin_ptr = segregated_list[i];
-				/*
-				This while loop goes through one index in our array of pointers and then applies the appropriate tests
-				*/
-				while(GET_NEXT_FREE_BLK(bin_ptr)!=0){
-				
-					//is every block in free list marked as free
-					if(test==0 || test==1){
-						if(GET_ALLOC(HDRP(bin_ptr))!=0)
-						{
-							printf("Block not assigned properly\n");				
-							return 0;
-						}	
-					}
-					//are block contigous and if they exist on the free list
-					if(test==2 || test==0){
-					
-						if(GET_PREV_FREE_BLK(bin_ptr)!=0){
-					
-							if(GET_PREV_FREE_BLK(GET_NEXT_FREE_BLK(bin_ptr)) != bin_ptr){
-
-								printf("Previous block not coalesced properly\n");
-								return 0;
-							};
-							if(GET_NEXT_FREE_BLK(GET_PREV_FREE_BLK(bin_ptr)) != bin_ptr){
-
-								printf("Previous block not coalesced properly\n");
-								return 0;
-							};					
-						}
-					}		
-					
-					//Valid heap pointers
-					if(test==3 || test==0){
-					
-						if(bin_ptr<mem_heap_low() && bin_ptr > mem_heap_hi()){
-						
-							printf("Out of heap\n");
-							return 0;
-						}
-					}					
-					bin_ptr = GET_NEXT_FREE_BLK(bin_ptr);
-				}	
-				//is every block in free list marked as free
-				if(test == 1 || test==0){
-				
-					if(GET_ALLOC(HDRP(bin_ptr))!=0)
-					{
-						printf("Block not assigned properly\n");				
-						return 0;
-					}	
-				}	
-				//Valid heap pointers
-				if(test==3 || test==0){
-				
-					if(bin_ptr<mem_heap_low() && bin_ptr > mem_heap_hi()){
-					
-						printf("Out of heap\n");
-						return 0;
-					}
-				}					
-			}	
+			}
+			//do the block and the list agree on its slot, size and list
+			if(test==2 || test==0){
+
+				if(GET_FREE_SLOT(bin_ptr) != j || SIZE_UNITS(GET_SIZE(HDRP(bin_ptr))) != list->units[j]
+						|| get_segregated_index(GET_SIZE(HDRP(bin_ptr))) != i){
+
+					printf("Block not listed properly\n");
+					return 0;
+				}
+			}
 		}
+	}
 	return 1;
 }
 
@@ -775,7 +1675,7 @@ int mm_check(void){
 	int test_type=0;
 	//0 : run all tests
 	//1 : every block in free list marked free/ free block test
-	//2 : contigous blocks test
+	//2 : list slot and size test
 	//3 : heap consistency
 	//We havn't allocated any pointers on the heap ourselves so there is no need to test it
 	print_seg(1);
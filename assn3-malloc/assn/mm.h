@@ -7,6 +7,51 @@ int mm_init(void);
 void *mm_malloc(size_t size);
 void mm_free(void *ptr);
 void *mm_realloc(void *ptr, size_t size);
+void *mm_calloc(size_t nmemb, size_t size);
+
+/*
+ * Lifetime hints for mm_malloc_hint. Short and long lived objects are
+ * kept in separate regions of the heap; MM_HINT_AUTO learns which of
+ * the two a size belongs to by watching a sample of them.
+ */
+#define MM_HINT_UNKNOWN 0
+#define MM_HINT_SHORT   1
+#define MM_HINT_LONG    2
+#define MM_HINT_AUTO    3
+
+void *mm_malloc_hint(size_t size, int hint);
+
+/*
+ * Heap statistics, gathered by walking the heap. Used by the mmstat
+ * trace analyzer; not needed by the driver.
+ */
+#define MM_STATS_MAX_BINS 64
+
+typedef struct {
+    size_t heap_size;          /* bytes obtained from mem_sbrk */
+    size_t alloc_blocks;       /* allocated blocks and their total size, */
+    size_t alloc_bytes;        /*   headers and footers included */
+    size_t free_blocks;
+    size_t free_bytes;
+    size_t largest_free;
+    int bins;                  /* segregated lists in use */
+    size_t bin_free_blocks[MM_STATS_MAX_BINS];
+    size_t bin_free_bytes[MM_STATS_MAX_BINS];
+    size_t splits;             /* blocks split by place since mm_init */
+    size_t split_free_blocks;  /* split remainders still free and */
+    size_t split_free_bytes;   /*   not yet coalesced */
+    size_t slot_map_bytes;     /* malloc'd outside the heap for the slot */
+    size_t free_list_bytes;    /*   map and the segregated list arrays */
+} mm_stats_t;
+
+void mm_get_stats(mm_stats_t *st);
+size_t mm_block_size(void *ptr);
+
+/*
+ * Histogram of the block sizes handed out, for mmclass -H. Only
+ * recorded when the allocator is built with -DMM_SIZE_HISTOGRAM.
+ */
+int mm_dump_size_histogram(const char *filename);
 
 /* 
  * Students work in teams of one or two.  Teams enter their team name, personal
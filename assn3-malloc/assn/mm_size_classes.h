@@ -0,0 +1,16 @@
+/*
+ * Segregated list size classes, generated by mmclass.
+ * Regenerate with "make size-classes TRACES=..." rather than by hand.
+ *
+ * size_class_max[i] is the largest block size kept in list i; the
+ * last list takes everything bigger.
+ *
+ * source: built-in default
+ */
+
+#define FREE_SIZE_BUCKETS 17
+
+static const size_t size_class_max[FREE_SIZE_BUCKETS] = {
+	16, 32, 48, 64, 80, 96, 112, 128, 255, 511, 1023, 2047, 4095, 8191,
+	16383, 32767, SIZE_MAX
+};
@@ -0,0 +1,497 @@
+/*
+ * mmclass - derive the segregated list size classes from a workload.
+ *
+ * Reads the block sizes a workload asks for, either by replaying the
+ * requests in .rep traces or from histograms the allocator dumped with
+ * mm_dump_size_histogram(), and writes a new mm_size_classes.h.
+ *
+ * The table is chosen by dynamic programming over the distinct block
+ * sizes seen. The free blocks of a list are assumed to come in the same
+ * mix of sizes as the requests it serves, and for every request the
+ * search in find_segregated_best_fit is costed as
+ * 	1. the waste: place() splits off anything of MIN_SPLIT bytes or
+ *	   more, so only a block less than MIN_SPLIT bigger than the
+ *	   request wastes memory. The search stops at the first such
+ *	   block in its list, so the waste is their average leftover.
+ *	2. plus lambda bytes for every entry find_fit scans: the entries
+ *	   up to the first of those blocks, at most FIT_SCAN_MAX.
+ *	3. plus lambda bytes for every entry of a miss, when the window
+ *	   holds no block big enough: one step up to the next list and
+ *	   a scan of its window.
+ * get_segregated_index is a table lookup, so the number of lists costs
+ * nothing by itself; narrower lists make for shorter scans and fewer
+ * misses, and a boundary between two close sizes avoids the waste of
+ * handing out one for the other.
+ * Free lists also hold coalesced blocks bigger than any request, so
+ * doubling lists are added above the largest size seen (up to 32KB or
+ * four times that size) and the last list is always open ended.
+ *
+ * The cost is only a proxy for how the heap behaves: the blocks that
+ * are free at any one time can be a very different mix from the
+ * requests (binary-bal frees only one of its sizes). Check a new table
+ * with mdriver or mmstat before committing it.
+ *
+ * usage: mmclass [-n <lists>] [-l <lambda>] [-o <file>] [-H <histogram>]... [<tracefile>...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "mm.h"
+#include "mm_size_classes.h"
+
+#define WSIZE       sizeof(void *)      /* must match mm.c */
+#define DSIZE       (2 * WSIZE)
+
+#define MAX(x,y) ((x) > (y)?(x) :(y))
+#define MIN(x,y) ((x) < (y)?(x) :(y))
+
+#define TAIL_LIMIT  32768               /* doubling lists reach at least this */
+#define MIN_SPLIT   32                  /* must match place() in mm.c */
+#define FIT_SCAN_MAX 64                 /* must match mm.c */
+#define DEFAULT_LISTS 8                 /* request lists of the original allocator */
+
+typedef struct {
+	size_t size;
+	double count;
+} size_count;
+
+static size_count *hist = NULL;
+static int hist_len = 0, hist_cap = 0;
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: mmclass [-n <lists>] [-l <lambda>] [-o <file>] "
+			"[-H <histogram>]... [<tracefile>...]\n");
+	fprintf(stderr, "\t-n <lists>      Lists for the request sizes (default %d, max %d).\n",
+			DEFAULT_LISTS, MM_STATS_MAX_BINS - 1);
+	fprintf(stderr, "\t-l <lambda>     Bytes of waste one scanned entry is worth (default 1).\n");
+	fprintf(stderr, "\t-o <file>       Write the table to <file> instead of stdout.\n");
+	fprintf(stderr, "\t-H <histogram>  Read block sizes dumped by the allocator.\n");
+	exit(1);
+}
+
+/* Block size mm_malloc hands out for a request of size bytes */
+static size_t adjust_size(size_t size)
+{
+	if (size <= DSIZE)
+		return 2 * DSIZE;
+	return DSIZE * ((size + (DSIZE) + (DSIZE-1)) / DSIZE);
+}
+
+static void add_size(size_t size, double count)
+{
+	if (hist_len == hist_cap)
+	{
+		hist_cap = hist_cap ? 2 * hist_cap : 1024;
+		if ((hist = realloc(hist, hist_cap * sizeof(size_count))) == NULL)
+		{
+			fprintf(stderr, "mmclass: out of memory\n");
+			exit(1);
+		}
+	}
+	hist[hist_len].size = size;
+	hist[hist_len].count = count;
+	hist_len++;
+}
+
+static int cmp_size(const void *a, const void *b)
+{
+	size_t x = ((const size_count *)a)->size, y = ((const size_count *)b)->size;
+	return (x > y) - (x < y);
+}
+
+/**********************************************************
+ * merge_sizes
+ * Sort the histogram and fold duplicate sizes together
+ **********************************************************/
+static void merge_sizes(void)
+{
+	int i, n = 0;
+
+	qsort(hist, hist_len, sizeof(size_count), cmp_size);
+	for (i = 0; i < hist_len; i++)
+	{
+		if (n > 0 && hist[n-1].size == hist[i].size)
+			hist[n-1].count += hist[i].count;
+		else
+			hist[n++] = hist[i];
+	}
+	hist_len = n;
+}
+
+/**********************************************************
+ * read_trace
+ * Adds the block size of every malloc and realloc request
+ * in a .rep trace. Returns 0 on success, -1 on error.
+ **********************************************************/
+static int read_trace(const char *filename)
+{
+	FILE *fp;
+	int heap_hint, num_ids, num_ops, weight, op, id;
+	size_t size;
+	char type[2];
+
+	if ((fp = fopen(filename, "r")) == NULL)
+	{
+		fprintf(stderr, "mmclass: could not open %s\n", filename);
+		return -1;
+	}
+	if (fscanf(fp, "%d %d %d %d", &heap_hint, &num_ids, &num_ops, &weight) != 4)
+	{
+		fprintf(stderr, "mmclass: bad trace header in %s\n", filename);
+		fclose(fp);
+		return -1;
+	}
+
+	for (op = 0; op < num_ops && fscanf(fp, "%1s %d", type, &id) == 2; op++)
+	{
+		if (type[0] == 'f')
+			continue;
+		if (fscanf(fp, "%zu", &size) != 1)
+		{
+			fprintf(stderr, "mmclass: bad op %d in %s\n", op, filename);
+			fclose(fp);
+			return -1;
+		}
+		add_size(adjust_size(size), 1);
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+/**********************************************************
+ * read_histogram
+ * Adds "<block size> <count>" lines as written by
+ * mm_dump_size_histogram. Returns 0 on success, -1 on error.
+ **********************************************************/
+static int read_histogram(const char *filename)
+{
+	FILE *fp;
+	char line[256];
+	size_t size;
+	double count;
+
+	if ((fp = fopen(filename, "r")) == NULL)
+	{
+		fprintf(stderr, "mmclass: could not open %s\n", filename);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "%zu %lf", &size, &count) != 2)
+		{
+			fprintf(stderr, "mmclass: bad line in %s: %s", filename, line);
+			fclose(fp);
+			return -1;
+		}
+		add_size(size, count);
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+static double *count_sum, *size_sum;   /* prefix sums over hist */
+static int *near_end;                   /* first size at least MIN_SPLIT above hist[t] */
+
+/**********************************************************
+ * setup_sums
+ * Prefix sums of the counts and sizes, and how far the
+ * sizes that fill a request without a split reach
+ **********************************************************/
+static void setup_sums(void)
+{
+	int i, e = 0;
+
+	count_sum = calloc(hist_len + 1, sizeof(double));
+	size_sum = calloc(hist_len + 1, sizeof(double));
+	near_end = malloc(hist_len * sizeof(int));
+	if (!count_sum || !size_sum || !near_end)
+	{
+		fprintf(stderr, "mmclass: out of memory\n");
+		exit(1);
+	}
+
+	for (i = 0; i < hist_len; i++)
+	{
+		count_sum[i+1] = count_sum[i] + hist[i].count;
+		size_sum[i+1] = size_sum[i] + hist[i].count * hist[i].size;
+		for (; e < hist_len && hist[e].size < hist[i].size + MIN_SPLIT; e++)
+			;
+		near_end[i] = e;
+	}
+}
+
+/* Sums over the requests of one list that list_cost turns into a cost */
+typedef struct {
+	double count;       /* requests */
+	double waste;       /* leftover too small to split */
+	double scan;        /* entries to the first block that needs no split, per block of the list */
+	double miss;        /* blocks of the list too small for them, per block that fits */
+} list_sums;
+
+/**********************************************************
+ * add_request
+ * Add the requests of size hist[t] to the sums of a list
+ * that ends at hist[j]
+ **********************************************************/
+static void add_request(list_sums *ls, int t, int j)
+{
+	int m = MIN(near_end[t], j + 1);
+	double near = count_sum[m] - count_sum[t];
+	double fit = count_sum[j+1] - count_sum[t];
+	double c = hist[t].count;
+
+	ls->count += c;
+	ls->waste += c * (size_sum[m] - size_sum[t] - near * hist[t].size) / near;
+	ls->scan += c / near;
+	ls->miss += c / fit;
+}
+
+/**********************************************************
+ * list_cost
+ * Cost of the requests of one list, see the top of the file.
+ * A request whose sizes make up near out of the count blocks
+ * of its list finds one after count/near entries; it misses
+ * the window about (count/fit - 1)/FIT_SCAN_MAX of the time.
+ **********************************************************/
+static double list_cost(const list_sums *ls, double lambda, double *waste)
+{
+	double scan = MIN(FIT_SCAN_MAX * ls->count, ls->count * ls->scan);
+	double miss = MIN(ls->count, ls->count * (ls->miss - 1) / FIT_SCAN_MAX);
+
+	*waste += ls->waste;
+	return ls->waste + lambda * (scan + miss * (1 + FIT_SCAN_MAX));
+}
+
+/**********************************************************
+ * table_cost
+ * Cost of serving the histogram with the given table, with
+ * the same model the search minimizes. The open ended last
+ * list is capped at the largest size seen.
+ **********************************************************/
+static double table_cost(const size_t *table, int lists, double lambda, double *waste)
+{
+	double cost = 0;
+	int i = 0, k, j, t;
+
+	*waste = 0;
+	for (k = 0; k < lists && i < hist_len; k++)
+	{
+		size_t hi = (k == lists - 1) ? SIZE_MAX : table[k];
+		list_sums ls = {0, 0, 0, 0};
+
+		//sizes kept in list k are hist[i..j-1]
+		for (j = i; j < hist_len && hist[j].size <= hi; j++)
+			;
+		if (j == i)
+			continue;
+		for (t = i; t < j; t++)
+			add_request(&ls, t, j - 1);
+		cost += list_cost(&ls, lambda, waste);
+		i = j;
+	}
+	return cost;
+}
+
+/**********************************************************
+ * choose_classes
+ * Dynamic program over the sorted distinct sizes:
+ * best[k][j] is the cheapest way to cover sizes 0..j with
+ * lists 0..k where list k ends at size j. The cost of a
+ * list only depends on the sizes it holds, so it is worked
+ * out once for every start i as i walks down from j.
+ * Returns the number of lists used; table gets their bounds.
+ **********************************************************/
+static int choose_classes(int lists, double lambda, size_t *table)
+{
+	int n = hist_len, k, i, j, used = 0;
+	double *range = malloc(n * sizeof(double));
+	double *best = malloc((size_t)lists * n * sizeof(double));
+	int *from = malloc((size_t)lists * n * sizeof(int));
+	list_sums ls;
+	double c, waste = 0;
+
+	if (!range || !best || !from)
+	{
+		fprintf(stderr, "mmclass: out of memory\n");
+		exit(1);
+	}
+
+	for (j = 0; j < n; j++)
+	{
+		//range[i] is the cost of one list holding sizes i..j
+		memset(&ls, 0, sizeof(ls));
+		for (i = j; i >= 0; i--)
+		{
+			add_request(&ls, i, j);
+			range[i] = list_cost(&ls, lambda, &waste);
+		}
+
+		best[j] = range[0];
+		from[j] = 0;
+		for (k = 1; k < lists; k++)
+		{
+			best[k*n + j] = best[(k-1)*n + j];       //list k left empty
+			from[k*n + j] = -1;
+			for (i = 1; i <= j; i++)
+			{
+				c = best[(k-1)*n + i-1] + range[i];
+				if (c < best[k*n + j])
+				{
+					best[k*n + j] = c;
+					from[k*n + j] = i;
+				}
+			}
+		}
+	}
+
+	//walk the choices back from the last list and size
+	for (k = lists - 1, j = n - 1; k >= 0 && j >= 0; k--)
+	{
+		i = (k == 0) ? 0 : from[k*n + j];
+		if (i < 0)
+			continue;
+		table[used++] = hist[j].size;
+		j = i - 1;
+	}
+	//bounds were collected from the top down
+	for (i = 0; i < used / 2; i++)
+	{
+		size_t t = table[i];
+		table[i] = table[used-1-i];
+		table[used-1-i] = t;
+	}
+
+	free(range);
+	free(best);
+	free(from);
+	return used;
+}
+
+/**********************************************************
+ * add_free_tail
+ * Appends doubling lists above the largest request size,
+ * which closes the lists choose_classes picked, and then
+ * the open ended last list. Returns the number of lists.
+ **********************************************************/
+static int add_free_tail(size_t *table, int used)
+{
+	size_t top = table[used-1];
+	size_t limit = MAX(TAIL_LIMIT, 4 * top);
+	size_t bound;
+
+	for (bound = 2 * DSIZE; bound <= top; bound <<= 1)
+		;
+	for (; bound <= limit && used < MM_STATS_MAX_BINS - 1; bound <<= 1)
+		table[used++] = bound - 1;
+	table[used++] = SIZE_MAX;
+	return used;
+}
+
+/**********************************************************
+ * write_table
+ * Emit mm_size_classes.h
+ **********************************************************/
+static void write_table(FILE *fp, const size_t *table, int used, char **sources, int nsources)
+{
+	int i;
+
+	fprintf(fp, "/*\n"
+			" * Segregated list size classes, generated by mmclass.\n"
+			" * Regenerate with \"make size-classes TRACES=...\" rather than by hand.\n"
+			" *\n"
+			" * size_class_max[i] is the largest block size kept in list i; the\n"
+			" * last list takes everything bigger.\n"
+			" *\n"
+			" * source:");
+	for (i = 0; i < nsources; i++)
+		fprintf(fp, " %s", sources[i]);
+	fprintf(fp, "\n */\n\n#define FREE_SIZE_BUCKETS %d\n\n"
+			"static const size_t size_class_max[FREE_SIZE_BUCKETS] = {\n\t", used);
+	for (i = 0; i < used - 1; i++)
+		fprintf(fp, "%zu,%s", table[i], (i % 10 == 9) ? "\n\t" : " ");
+	fprintf(fp, "SIZE_MAX\n};\n");
+}
+
+int main(int argc, char **argv)
+{
+	int c, i, lists = DEFAULT_LISTS, used, nsources = 0;
+	double lambda = 1, waste, cost;
+	const char *outfile = NULL;
+	char **sources = calloc(argc, sizeof(char *));
+	size_t table[MM_STATS_MAX_BINS];
+	FILE *fp = stdout;
+
+	while ((c = getopt(argc, argv, "n:l:o:H:h")) != EOF)
+	{
+		switch (c)
+		{
+		case 'n':
+			lists = atoi(optarg);
+			if (lists < 1 || lists > MM_STATS_MAX_BINS - 1)
+				usage();
+			break;
+		case 'l':
+			lambda = atof(optarg);
+			break;
+		case 'o':
+			outfile = optarg;
+			break;
+		case 'H':
+			if (read_histogram(optarg) < 0)
+				return 1;
+			sources[nsources++] = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	for (i = optind; i < argc; i++)
+	{
+		if (read_trace(argv[i]) < 0)
+			return 1;
+		sources[nsources++] = argv[i];
+	}
+	if (nsources == 0)
+		usage();
+
+	merge_sizes();
+	if (hist_len == 0)
+	{
+		fprintf(stderr, "mmclass: no allocations found\n");
+		return 1;
+	}
+
+	setup_sums();
+	cost = table_cost(size_class_max, FREE_SIZE_BUCKETS, lambda, &waste);
+	fprintf(stderr, "current table: %d lists, cost %.0f, waste %.0f\n",
+			FREE_SIZE_BUCKETS, cost, waste);
+
+	used = add_free_tail(table, choose_classes(lists, lambda, table));
+	cost = table_cost(table, used, lambda, &waste);
+	fprintf(stderr, "new table:     %d lists, cost %.0f, waste %.0f\n", used, cost, waste);
+
+	if (outfile != NULL && (fp = fopen(outfile, "w")) == NULL)
+	{
+		fprintf(stderr, "mmclass: could not open %s\n", outfile);
+		return 1;
+	}
+	write_table(fp, table, used, sources, nsources);
+	if (fp != stdout)
+		fclose(fp);
+
+	free(sources);
+	free(hist);
+	free(count_sum);
+	free(size_sum);
+	free(near_end);
+	return 0;
+}
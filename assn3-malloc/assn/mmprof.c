@@ -0,0 +1,357 @@
+/*
+ * Sampling heap profiler.
+ *
+ * Sample points are drawn from an exponential distribution with a
+ * mean of "period" bytes, so every byte allocated has the same chance
+ * of being sampled no matter how the requests are sized. pprof undoes
+ * the sampling itself using the period written in the profile header.
+ *
+ * All bookkeeping lives in fixed size tables outside the heap so that
+ * the profiler never calls back into the allocator:
+ * 	1. stack_table holds one bucket per distinct stack trace with
+ *	   its in-use and cumulative object/byte counts.
+ *	2. live_table maps each live sampled block to its size and
+ *	   bucket so that mm_free can charge the right stack.
+ * Both are open addressing hash tables with linear probing. When
+ * either one fills up, new samples are dropped rather than grown.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <execinfo.h>
+
+#include "mmprof.h"
+
+#define MAX_DEPTH       32              /* frames kept per stack trace */
+#define SKIP_FRAMES     1               /* drop mm_prof_record_alloc itself */
+#define STACK_SLOTS     1024            /* must be a power of 2 */
+#define LIVE_SLOTS      8192            /* must be a power of 2 */
+
+typedef struct {
+	uintptr_t hash;         /* 0 marks an unused slot */
+	int depth;
+	void *pcs[MAX_DEPTH];
+	size_t inuse_objs;
+	size_t inuse_bytes;
+	size_t alloc_objs;
+	size_t alloc_bytes;
+} stack_bucket;
+
+typedef struct {
+	void *bp;               /* NULL marks an unused slot */
+	size_t size;
+	int stack;
+} live_object;
+
+long mm_prof_bytes_until_sample = LONG_MAX;
+
+static int prof_enabled = 0;
+static size_t sample_period = MM_PROF_DEFAULT_PERIOD;
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+static int env_checked = 0;
+
+static stack_bucket stack_table[STACK_SLOTS];
+static live_object live_table[LIVE_SLOTS];
+static int stack_count = 0;
+static int live_count = 0;
+
+/*************************************************************************
+ * Helpers
+ *************************************************************************/
+
+/* Hash a pointer sized key, used for both tables */
+static uintptr_t hash_word(uintptr_t x)
+{
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	return x;
+}
+
+/**********************************************************
+ * next_sample_distance
+ * Draw the number of bytes until the next sample from an
+ * exponential distribution with mean sample_period
+ **********************************************************/
+static long next_sample_distance(void)
+{
+	double u;
+
+	if (!prof_enabled)
+		return LONG_MAX;
+
+	//xorshift64*, uniform in (0,1]
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	u = ((rng_state * 0x2545F4914F6CDD1DULL >> 11) + 1) * (1.0 / 9007199254740992.0);
+
+	return (long)(-log(u) * sample_period);
+}
+
+/**********************************************************
+ * find_stack
+ * Returns the bucket for the given trace, creating it if
+ * needed. Returns -1 once the table is full.
+ **********************************************************/
+static int find_stack(void **pcs, int depth)
+{
+	uintptr_t h = 0;
+	int i, j;
+
+	for (i = 0; i < depth; i++)
+		h = hash_word(h ^ (uintptr_t)pcs[i]);
+	if (h == 0)
+		h = 1;
+
+	for (i = h & (STACK_SLOTS - 1); ; i = (i + 1) & (STACK_SLOTS - 1))
+	{
+		stack_bucket *b = &stack_table[i];
+
+		if (b->hash == 0)
+		{
+			//keep the table at most 3/4 full
+			if (stack_count >= STACK_SLOTS / 4 * 3)
+				return -1;
+			b->hash = h;
+			b->depth = depth;
+			for (j = 0; j < depth; j++)
+				b->pcs[j] = pcs[j];
+			stack_count++;
+			return i;
+		}
+		if (b->hash == h && b->depth == depth)
+		{
+			for (j = 0; j < depth && b->pcs[j] == pcs[j]; j++)
+				;
+			if (j == depth)
+				return i;
+		}
+	}
+}
+
+/**********************************************************
+ * find_live
+ * Returns the slot holding bp, or the empty slot where it
+ * would be inserted
+ **********************************************************/
+static int find_live(void *bp)
+{
+	int i = hash_word((uintptr_t)bp) & (LIVE_SLOTS - 1);
+
+	while (live_table[i].bp != NULL && live_table[i].bp != bp)
+		i = (i + 1) & (LIVE_SLOTS - 1);
+	return i;
+}
+
+/**********************************************************
+ * remove_live
+ * Empties slot i, shifting back any entries of the probe
+ * run that follows so lookups never hit a premature hole
+ **********************************************************/
+static void remove_live(int i)
+{
+	int j = i, home;
+
+	live_table[i].bp = NULL;
+	live_count--;
+
+	for (;;)
+	{
+		j = (j + 1) & (LIVE_SLOTS - 1);
+		if (live_table[j].bp == NULL)
+			return;
+		home = hash_word((uintptr_t)live_table[j].bp) & (LIVE_SLOTS - 1);
+		//move j into the hole unless its home lies cyclically in (i, j]
+		if ((i <= j) ? (home <= i || home > j) : (home <= i && home > j))
+		{
+			live_table[i] = live_table[j];
+			live_table[j].bp = NULL;
+			i = j;
+		}
+	}
+}
+
+/* Write the profile at exit when it was enabled from the environment */
+static void dump_at_exit(void)
+{
+	mm_prof_dump(getenv("MM_HEAPPROF"));
+}
+
+/**********************************************************
+ * check_env
+ * Turn the profiler on if MM_HEAPPROF names an output file
+ **********************************************************/
+static void check_env(void)
+{
+	const char *file = getenv("MM_HEAPPROF");
+	const char *period = getenv("MM_HEAPPROF_PERIOD");
+
+	env_checked = 1;
+	if (file == NULL || *file == '\0')
+		return;
+
+	mm_prof_start(period ? strtoul(period, NULL, 10) : MM_PROF_DEFAULT_PERIOD);
+	atexit(dump_at_exit);
+}
+
+/*************************************************************************
+ * Public interface
+ *************************************************************************/
+
+/**********************************************************
+ * mm_prof_start
+ * Start sampling about one allocation per period bytes
+ **********************************************************/
+void mm_prof_start(size_t period)
+{
+	sample_period = period ? period : MM_PROF_DEFAULT_PERIOD;
+	prof_enabled = 1;
+	mm_prof_bytes_until_sample = next_sample_distance();
+}
+
+/**********************************************************
+ * mm_prof_stop
+ * Stop taking new samples. Objects already sampled are
+ * still tracked until they are freed.
+ **********************************************************/
+void mm_prof_stop(void)
+{
+	prof_enabled = 0;
+	mm_prof_bytes_until_sample = LONG_MAX;
+}
+
+/**********************************************************
+ * mm_prof_reset
+ * Forget all live samples; called from mm_init since the
+ * heap they pointed into is gone. Cumulative counts are
+ * kept across resets. With no live samples the tables
+ * are already clear, which keeps mm_init cheap when the
+ * profiler is off.
+ **********************************************************/
+void mm_prof_reset(void)
+{
+	int i;
+
+	if (!env_checked)
+		check_env();
+	if (live_count == 0)
+		return;
+
+	for (i = 0; i < LIVE_SLOTS; i++)
+		live_table[i].bp = NULL;
+	live_count = 0;
+
+	for (i = 0; i < STACK_SLOTS; i++)
+	{
+		stack_table[i].inuse_objs = 0;
+		stack_table[i].inuse_bytes = 0;
+	}
+}
+
+/**********************************************************
+ * mm_prof_record_alloc
+ * Slow path of the sample countdown. Re-arms the countdown
+ * and records bp if profiling is on.
+ * Returns 1 if bp was sampled, 0 otherwise.
+ **********************************************************/
+int mm_prof_record_alloc(void *bp, size_t size)
+{
+	void *pcs[MAX_DEPTH + SKIP_FRAMES];
+	int depth, stack, slot;
+
+	mm_prof_bytes_until_sample = next_sample_distance();
+	if (!prof_enabled || live_count >= LIVE_SLOTS / 4 * 3)
+		return 0;
+
+	depth = backtrace(pcs, MAX_DEPTH + SKIP_FRAMES) - SKIP_FRAMES;
+	if (depth < 0)
+		depth = 0;
+	if ((stack = find_stack(pcs + SKIP_FRAMES, depth)) < 0)
+		return 0;
+
+	slot = find_live(bp);
+	live_table[slot].bp = bp;
+	live_table[slot].size = size;
+	live_table[slot].stack = stack;
+	live_count++;
+
+	stack_table[stack].inuse_objs++;
+	stack_table[stack].inuse_bytes += size;
+	stack_table[stack].alloc_objs++;
+	stack_table[stack].alloc_bytes += size;
+	return 1;
+}
+
+/**********************************************************
+ * mm_prof_record_free
+ * Called for blocks the allocator marked as sampled
+ **********************************************************/
+void mm_prof_record_free(void *bp)
+{
+	int slot = find_live(bp);
+	stack_bucket *b;
+
+	if (live_table[slot].bp == NULL)
+		return;
+
+	b = &stack_table[live_table[slot].stack];
+	b->inuse_objs--;
+	b->inuse_bytes -= live_table[slot].size;
+	remove_live(slot);
+}
+
+/**********************************************************
+ * mm_prof_dump
+ * Write the in-use and cumulative profile to filename in
+ * the legacy pprof heap format, followed by the memory map
+ * pprof needs to symbolize the addresses.
+ * Returns 0 on success, -1 on error.
+ **********************************************************/
+int mm_prof_dump(const char *filename)
+{
+	FILE *fp, *maps;
+	size_t inuse_objs = 0, inuse_bytes = 0, alloc_objs = 0, alloc_bytes = 0;
+	char line[1024];
+	int i, j;
+
+	if (filename == NULL || (fp = fopen(filename, "w")) == NULL)
+		return -1;
+
+	for (i = 0; i < STACK_SLOTS; i++)
+	{
+		inuse_objs += stack_table[i].inuse_objs;
+		inuse_bytes += stack_table[i].inuse_bytes;
+		alloc_objs += stack_table[i].alloc_objs;
+		alloc_bytes += stack_table[i].alloc_bytes;
+	}
+
+	fprintf(fp, "heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu\n",
+			inuse_objs, inuse_bytes, alloc_objs, alloc_bytes, sample_period);
+
+	for (i = 0; i < STACK_SLOTS; i++)
+	{
+		stack_bucket *b = &stack_table[i];
+
+		if (b->hash == 0 || b->alloc_objs == 0)
+			continue;
+		fprintf(fp, "%zu: %zu [%zu: %zu] @", b->inuse_objs, b->inuse_bytes,
+				b->alloc_objs, b->alloc_bytes);
+		for (j = 0; j < b->depth; j++)
+			fprintf(fp, " %p", b->pcs[j]);
+		fprintf(fp, "\n");
+	}
+
+	fprintf(fp, "\nMAPPED_LIBRARIES:\n");
+	if ((maps = fopen("/proc/self/maps", "r")) != NULL)
+	{
+		while (fgets(line, sizeof(line), maps) != NULL)
+			fputs(line, fp);
+		fclose(maps);
+	}
+
+	return fclose(fp) == 0 ? 0 : -1;
+}
@@ -0,0 +1,31 @@
+/*- -*- mode: c; c-basic-offset: 4; -*-
+ *
+ * Sampling heap profiler for the memory allocator.
+ *
+ * Roughly one allocation per "period" bytes is sampled, its stack
+ * trace is recorded and the object is tracked until it is freed.
+ * Profiles are written in the legacy pprof heap format, so both
+ * "pprof -inuse_space" and "pprof -alloc_space" work on the dump.
+ *
+ * Profiling can also be turned on without code changes by setting
+ * MM_HEAPPROF=<file> (and optionally MM_HEAPPROF_PERIOD=<bytes>)
+ * in the environment; the profile is then written at exit.
+ */
+
+#define MM_PROF_DEFAULT_PERIOD (512 * 1024)
+
+/*
+ * Bytes left before the next sample. The allocator subtracts every
+ * request from it and only calls into the profiler once it goes
+ * negative, so a disabled profiler costs one decrement per malloc.
+ */
+extern long mm_prof_bytes_until_sample;
+
+void mm_prof_start(size_t period);
+void mm_prof_stop(void);
+void mm_prof_reset(void);
+int mm_prof_dump(const char *filename);
+
+/* Called by the allocator only */
+int mm_prof_record_alloc(void *bp, size_t size);
+void mm_prof_record_free(void *bp);
@@ -0,0 +1,253 @@
+/*
+ * mmstat - replay .rep traces against the allocator and report how
+ * the heap is used over time.
+ *
+ * After every op (or every -i ops) one sample is printed with:
+ * 	1. live payload (bytes the trace asked for) against heap size,
+ *	2. internal fragmentation, the gap between the requested sizes
+ *	   and the size of the blocks place() handed out,
+ *	3. external fragmentation, the free bytes in each segregated
+ *	   list and the largest free block,
+ *	4. the remainders left behind by splitting that are still free,
+ *	5. the memory the free lists and their slot map take outside the
+ *	   heap, which mdriver's utilization does not see.
+ *
+ * usage: mmstat [-j] [-i <ops>] <tracefile>...
+ *
+ * Output is CSV by default, or JSON with -j.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+typedef struct {
+	void *ptr;
+	size_t request;         /* bytes asked for by the trace */
+	size_t block;           /* size of the block that was handed out */
+} trace_id;
+
+static int json = 0;
+static int interval = 1;
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: mmstat [-j] [-i <ops>] <tracefile>...\n");
+	fprintf(stderr, "\t-j         Print JSON instead of CSV.\n");
+	fprintf(stderr, "\t-i <ops>   Print one sample every <ops> ops.\n");
+	exit(1);
+}
+
+/**********************************************************
+ * print_header
+ * CSV column names, one free bytes column per segregated
+ * list
+ **********************************************************/
+static void print_header(int bins)
+{
+	int i;
+
+	printf("trace,op,live_payload,heap_size,alloc_blocks,alloc_bytes,"
+			"internal_frag,free_blocks,free_bytes,largest_free,"
+			"splits,split_free_blocks,split_free_bytes,slot_map_bytes,free_list_bytes");
+	for (i = 0; i < bins; i++)
+		printf(",bin%d_free_bytes", i);
+	printf("\n");
+}
+
+/**********************************************************
+ * print_sample
+ * Prints one row (CSV) or one object (JSON)
+ **********************************************************/
+static void print_sample(const char *trace, int op, int first,
+		size_t live, long internal, mm_stats_t *st)
+{
+	int i;
+
+	if (!json)
+	{
+		printf("%s,%d,%zu,%zu,%zu,%zu,%ld,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu", trace, op,
+				live, st->heap_size, st->alloc_blocks, st->alloc_bytes,
+				internal, st->free_blocks, st->free_bytes, st->largest_free,
+				st->splits, st->split_free_blocks, st->split_free_bytes,
+				st->slot_map_bytes, st->free_list_bytes);
+		for (i = 0; i < st->bins; i++)
+			printf(",%zu", st->bin_free_bytes[i]);
+		printf("\n");
+		return;
+	}
+
+	printf("%s\n    {\"op\": %d, \"live_payload\": %zu, \"heap_size\": %zu, "
+			"\"alloc_blocks\": %zu, \"alloc_bytes\": %zu, \"internal_frag\": %ld, "
+			"\"free_blocks\": %zu, \"free_bytes\": %zu, \"largest_free\": %zu, "
+			"\"splits\": %zu, \"split_free_blocks\": %zu, \"split_free_bytes\": %zu, "
+			"\"slot_map_bytes\": %zu, \"free_list_bytes\": %zu, "
+			"\"bin_free_blocks\": [", first ? "" : ",", op,
+			live, st->heap_size, st->alloc_blocks, st->alloc_bytes, internal,
+			st->free_blocks, st->free_bytes, st->largest_free,
+			st->splits, st->split_free_blocks, st->split_free_bytes,
+			st->slot_map_bytes, st->free_list_bytes);
+	for (i = 0; i < st->bins; i++)
+		printf("%s%zu", i ? ", " : "", st->bin_free_blocks[i]);
+	printf("], \"bin_free_bytes\": [");
+	for (i = 0; i < st->bins; i++)
+		printf("%s%zu", i ? ", " : "", st->bin_free_bytes[i]);
+	printf("]}");
+}
+
+/**********************************************************
+ * replay
+ * Runs one trace file from a fresh heap, printing samples
+ * as it goes. Returns 0 on success, -1 on error.
+ **********************************************************/
+static int replay(const char *filename, int first_trace)
+{
+	FILE *fp;
+	trace_id *ids;
+	int heap_hint, num_ids, num_ops, weight;
+	int op, id, first = 1;
+	size_t size, live = 0, peak_live = 0, peak_heap = 0, side;
+	long internal = 0;
+	char type[2];
+	void *p;
+	mm_stats_t st;
+	const char *trace = strrchr(filename, '/') ? strrchr(filename, '/') + 1 : filename;
+
+	if ((fp = fopen(filename, "r")) == NULL)
+	{
+		fprintf(stderr, "mmstat: could not open %s\n", filename);
+		return -1;
+	}
+	if (fscanf(fp, "%d %d %d %d", &heap_hint, &num_ids, &num_ops, &weight) != 4
+			|| (ids = calloc(num_ids, sizeof(trace_id))) == NULL)
+	{
+		fprintf(stderr, "mmstat: bad trace header in %s\n", filename);
+		fclose(fp);
+		return -1;
+	}
+
+	mem_reset_brk();
+	if (mm_init() < 0)
+	{
+		fprintf(stderr, "mmstat: mm_init failed\n");
+		return -1;
+	}
+
+	if (json)
+		printf("%s  {\"trace\": \"%s\", \"samples\": [", first_trace ? "" : ",\n", trace);
+
+	for (op = 0; op < num_ops && fscanf(fp, "%1s", type) == 1; op++)
+	{
+		if (fscanf(fp, "%d", &id) != 1 || id < 0 || id >= num_ids
+				|| (type[0] != 'f' && fscanf(fp, "%zu", &size) != 1))
+		{
+			fprintf(stderr, "mmstat: bad op %d in %s\n", op, filename);
+			return -1;
+		}
+
+		switch (type[0])
+		{
+		case 'a':
+			p = mm_malloc(size);
+			break;
+		case 'r':
+			p = mm_realloc(ids[id].ptr, size);
+			break;
+		case 'f':
+			mm_free(ids[id].ptr);
+			p = NULL;
+			size = 0;
+			break;
+		default:
+			fprintf(stderr, "mmstat: bad op type '%c' in %s\n", type[0], filename);
+			return -1;
+		}
+		if (p == NULL && size > 0)
+		{
+			fprintf(stderr, "mmstat: out of memory at op %d in %s\n", op, filename);
+			return -1;
+		}
+
+		//retire the old block, if any, and account for the new one
+		if (ids[id].ptr != NULL)
+		{
+			live -= ids[id].request;
+			internal -= (long)ids[id].block - (long)ids[id].request;
+		}
+		ids[id].ptr = p;
+		ids[id].request = size;
+		ids[id].block = p ? mm_block_size(p) : 0;
+		live += size;
+		internal += (long)ids[id].block - (long)size;
+
+		if (live > peak_live)
+			peak_live = live;
+		if (mem_heapsize() > peak_heap)
+			peak_heap = mem_heapsize();
+
+		if ((op + 1) % interval == 0 || op + 1 == num_ops)
+		{
+			mm_get_stats(&st);
+			if (!json && first_trace && first)
+				print_header(st.bins);
+			print_sample(trace, op, first, live, internal, &st);
+			first = 0;
+		}
+	}
+
+	if (json)
+		printf("\n  ]}");
+
+	//the slot map and list arrays never shrink, so they are at their peak now
+	mm_get_stats(&st);
+	side = st.slot_map_bytes + st.free_list_bytes;
+	fprintf(stderr, "%s: peak payload %zu, peak heap %zu, util %.1f%%, "
+			"outside the heap %zu, util %.1f%% counting it\n", trace,
+			peak_live, peak_heap, peak_heap ? 100.0 * peak_live / peak_heap : 0.0,
+			side, 100.0 * peak_live / (peak_heap + side));
+
+	free(ids);
+	fclose(fp);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int c, i;
+
+	while ((c = getopt(argc, argv, "ji:h")) != EOF)
+	{
+		switch (c)
+		{
+		case 'j':
+			json = 1;
+			break;
+		case 'i':
+			if ((interval = atoi(optarg)) < 1)
+				usage();
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind == argc)
+		usage();
+
+	mem_init();
+
+	if (json)
+		printf("[\n");
+	for (i = optind; i < argc; i++)
+		if (replay(argv[i], i == optind) < 0)
+			return 1;
+	if (json)
+		printf("\n]\n");
+
+	mem_deinit();
+	return 0;
+}